@@ -0,0 +1,284 @@
+#include <limits.h>
+
+#include "include/aggregate.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+#ifdef __SSE2__
+// SSE2 has no 32 bit min/max, so select through a compare mask unless SSE4.1 is there
+static inline __m128i min_epi32(__m128i a, __m128i b) {
+#ifdef __SSE4_1__
+    return _mm_min_epi32(a, b);
+#else
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+#endif
+}
+
+static inline __m128i max_epi32(__m128i a, __m128i b) {
+#ifdef __SSE4_1__
+    return _mm_max_epi32(a, b);
+#else
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+#endif
+}
+
+// sign extends the four ints of values into two vectors of two longs and adds them to the accumulators
+static inline void add_epi32_to_epi64(__m128i values, __m128i* low, __m128i* high) {
+    __m128i sign = _mm_srai_epi32(values, 31);
+    *low = _mm_add_epi64(*low, _mm_unpacklo_epi32(values, sign));
+    *high = _mm_add_epi64(*high, _mm_unpackhi_epi32(values, sign));
+}
+
+static inline long horizontal_sum_epi64(__m128i sums) {
+    long lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, sums);
+    return lanes[0] + lanes[1];
+}
+
+static inline int horizontal_min_epi32(__m128i mins) {
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, mins);
+    int min = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    int min2 = lanes[2] < lanes[3] ? lanes[2] : lanes[3];
+    return min < min2 ? min : min2;
+}
+
+static inline int horizontal_max_epi32(__m128i maxs) {
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, maxs);
+    int max = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    int max2 = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+    return max > max2 ? max : max2;
+}
+#endif
+
+long sum_values(int* data, size_t num_values) {
+    size_t i = 0;
+    long sum = 0;
+#ifdef __SSE2__
+    __m128i sum0 = _mm_setzero_si128();
+    __m128i sum1 = _mm_setzero_si128();
+    __m128i sum2 = _mm_setzero_si128();
+    __m128i sum3 = _mm_setzero_si128();
+    for(; i + 8 <= num_values; i += 8) {
+        add_epi32_to_epi64(_mm_loadu_si128((__m128i*)(data + i)), &sum0, &sum1);
+        add_epi32_to_epi64(_mm_loadu_si128((__m128i*)(data + i + 4)), &sum2, &sum3);
+    }
+    sum = horizontal_sum_epi64(_mm_add_epi64(_mm_add_epi64(sum0, sum1), _mm_add_epi64(sum2, sum3)));
+#else
+    long sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    for(; i + 4 <= num_values; i += 4) {
+        sum0 += data[i];
+        sum1 += data[i + 1];
+        sum2 += data[i + 2];
+        sum3 += data[i + 3];
+    }
+    sum = sum0 + sum1 + sum2 + sum3;
+#endif
+    for(; i < num_values; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+int min_values(int* data, size_t num_values) {
+    size_t i = 0;
+    int min = INT_MAX;
+#ifdef __SSE2__
+    __m128i min0 = _mm_set1_epi32(INT_MAX);
+    __m128i min1 = min0;
+    for(; i + 8 <= num_values; i += 8) {
+        min0 = min_epi32(min0, _mm_loadu_si128((__m128i*)(data + i)));
+        min1 = min_epi32(min1, _mm_loadu_si128((__m128i*)(data + i + 4)));
+    }
+    min = horizontal_min_epi32(min_epi32(min0, min1));
+#else
+    int min0 = INT_MAX, min1 = INT_MAX;
+    for(; i + 2 <= num_values; i += 2) {
+        min0 = data[i] < min0 ? data[i] : min0;
+        min1 = data[i + 1] < min1 ? data[i + 1] : min1;
+    }
+    min = min0 < min1 ? min0 : min1;
+#endif
+    for(; i < num_values; i++) {
+        min = data[i] < min ? data[i] : min;
+    }
+    return min;
+}
+
+int max_values(int* data, size_t num_values) {
+    size_t i = 0;
+    int max = INT_MIN;
+#ifdef __SSE2__
+    __m128i max0 = _mm_set1_epi32(INT_MIN);
+    __m128i max1 = max0;
+    for(; i + 8 <= num_values; i += 8) {
+        max0 = max_epi32(max0, _mm_loadu_si128((__m128i*)(data + i)));
+        max1 = max_epi32(max1, _mm_loadu_si128((__m128i*)(data + i + 4)));
+    }
+    max = horizontal_max_epi32(max_epi32(max0, max1));
+#else
+    int max0 = INT_MIN, max1 = INT_MIN;
+    for(; i + 2 <= num_values; i += 2) {
+        max0 = data[i] > max0 ? data[i] : max0;
+        max1 = data[i + 1] > max1 ? data[i + 1] : max1;
+    }
+    max = max0 > max1 ? max0 : max1;
+#endif
+    for(; i < num_values; i++) {
+        max = data[i] > max ? data[i] : max;
+    }
+    return max;
+}
+
+// folds the vector into stats, start from {0, INT_MAX, INT_MIN, 0}
+void aggregate_values(int* data, size_t num_values, AggregateStats* stats) {
+    size_t i = 0;
+    long sum = 0;
+    int min = stats->min;
+    int max = stats->max;
+#ifdef __SSE2__
+    __m128i sum0 = _mm_setzero_si128();
+    __m128i sum1 = _mm_setzero_si128();
+    __m128i sum2 = _mm_setzero_si128();
+    __m128i sum3 = _mm_setzero_si128();
+    __m128i min0 = _mm_set1_epi32(min);
+    __m128i min1 = min0;
+    __m128i max0 = _mm_set1_epi32(max);
+    __m128i max1 = max0;
+    for(; i + 8 <= num_values; i += 8) {
+        __m128i values0 = _mm_loadu_si128((__m128i*)(data + i));
+        __m128i values1 = _mm_loadu_si128((__m128i*)(data + i + 4));
+        add_epi32_to_epi64(values0, &sum0, &sum1);
+        add_epi32_to_epi64(values1, &sum2, &sum3);
+        min0 = min_epi32(min0, values0);
+        min1 = min_epi32(min1, values1);
+        max0 = max_epi32(max0, values0);
+        max1 = max_epi32(max1, values1);
+    }
+    sum = horizontal_sum_epi64(_mm_add_epi64(_mm_add_epi64(sum0, sum1), _mm_add_epi64(sum2, sum3)));
+    min = horizontal_min_epi32(min_epi32(min0, min1));
+    max = horizontal_max_epi32(max_epi32(max0, max1));
+#else
+    long sum0 = 0, sum1 = 0;
+    int min0 = min, min1 = min, max0 = max, max1 = max;
+    for(; i + 2 <= num_values; i += 2) {
+        sum0 += data[i];
+        sum1 += data[i + 1];
+        min0 = data[i] < min0 ? data[i] : min0;
+        min1 = data[i + 1] < min1 ? data[i + 1] : min1;
+        max0 = data[i] > max0 ? data[i] : max0;
+        max1 = data[i + 1] > max1 ? data[i + 1] : max1;
+    }
+    sum = sum0 + sum1;
+    min = min0 < min1 ? min0 : min1;
+    max = max0 > max1 ? max0 : max1;
+#endif
+    for(; i < num_values; i++) {
+        sum += data[i];
+        min = data[i] < min ? data[i] : min;
+        max = data[i] > max ? data[i] : max;
+    }
+    stats->sum += sum;
+    stats->min = min;
+    stats->max = max;
+    stats->count += num_values;
+}
+
+long sum_long_values(long* data, size_t num_values) {
+    long sum0 = 0, sum1 = 0;
+    size_t i = 0;
+    for(; i + 2 <= num_values; i += 2) {
+        sum0 += data[i];
+        sum1 += data[i + 1];
+    }
+    for(; i < num_values; i++) {
+        sum0 += data[i];
+    }
+    return sum0 + sum1;
+}
+
+long min_long_values(long* data, size_t num_values) {
+    long min = LONG_MAX;
+    for(size_t i = 0; i < num_values; i++) {
+        min = data[i] < min ? data[i] : min;
+    }
+    return min;
+}
+
+long max_long_values(long* data, size_t num_values) {
+    long max = LONG_MIN;
+    for(size_t i = 0; i < num_values; i++) {
+        max = data[i] > max ? data[i] : max;
+    }
+    return max;
+}
+
+bool add_values(int* data1, int* data2, size_t num_values, int* out) {
+    size_t i = 0;
+    bool fits = true;
+#ifdef __SSE2__
+    // the 32 bit sum wrapped around iff its sign differs from the signs of both inputs
+    __m128i overflow = _mm_setzero_si128();
+    for(; i + 4 <= num_values; i += 4) {
+        __m128i values1 = _mm_loadu_si128((__m128i*)(data1 + i));
+        __m128i values2 = _mm_loadu_si128((__m128i*)(data2 + i));
+        __m128i sums = _mm_add_epi32(values1, values2);
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(values1, sums), _mm_xor_si128(values2, sums)));
+        _mm_storeu_si128((__m128i*)(out + i), sums);
+    }
+    fits = _mm_movemask_ps(_mm_castsi128_ps(overflow)) == 0;
+#endif
+    for(; i < num_values; i++) {
+        long sum = (long)data1[i] + data2[i];
+        out[i] = (int)sum;
+        fits &= sum == out[i];
+    }
+    return fits;
+}
+
+bool sub_values(int* data1, int* data2, size_t num_values, int* out) {
+    size_t i = 0;
+    bool fits = true;
+#ifdef __SSE2__
+    // the 32 bit difference wrapped around iff the inputs have different signs
+    // and the sign of the difference differs from the first one
+    __m128i overflow = _mm_setzero_si128();
+    for(; i + 4 <= num_values; i += 4) {
+        __m128i values1 = _mm_loadu_si128((__m128i*)(data1 + i));
+        __m128i values2 = _mm_loadu_si128((__m128i*)(data2 + i));
+        __m128i differences = _mm_sub_epi32(values1, values2);
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(values1, values2), _mm_xor_si128(values1, differences)));
+        _mm_storeu_si128((__m128i*)(out + i), differences);
+    }
+    fits = _mm_movemask_ps(_mm_castsi128_ps(overflow)) == 0;
+#endif
+    for(; i < num_values; i++) {
+        long difference = (long)data1[i] - data2[i];
+        out[i] = (int)difference;
+        fits &= difference == out[i];
+    }
+    return fits;
+}
+
+static inline long value_at(void* data, bool is_long, size_t pos) {
+    return is_long ? ((long*)data)[pos] : ((int*)data)[pos];
+}
+
+void add_long_values(void* data1, bool long1, void* data2, bool long2, size_t num_values, long* out) {
+    for(size_t i = 0; i < num_values; i++) {
+        out[i] = value_at(data1, long1, i) + value_at(data2, long2, i);
+    }
+}
+
+void sub_long_values(void* data1, bool long1, void* data2, bool long2, size_t num_values, long* out) {
+    for(size_t i = 0; i < num_values; i++) {
+        out[i] = value_at(data1, long1, i) - value_at(data2, long2, i);
+    }
+}
@@ -0,0 +1,25 @@
+#include <stdlib.h>
+
+#include "include/bloom_filter.h"
+
+BloomFilter* create_bloom_filter(size_t num_values) {
+    size_t num_blocks = 1;
+    while(num_blocks * 64 < num_values * BLOOM_BITS_PER_VALUE) {
+        num_blocks *= 2;
+    }
+    BloomFilter* filter = malloc(sizeof(BloomFilter));
+    filter->blocks = calloc(num_blocks, sizeof(uint64_t));
+    filter->mask = num_blocks - 1;
+    return filter;
+}
+
+void bloom_filter_add_values(BloomFilter* filter, int* values, size_t num_values) {
+    for(size_t i = 0; i < num_values; i++) {
+        bloom_filter_add(filter, values[i]);
+    }
+}
+
+void free_bloom_filter(BloomFilter* filter) {
+    free(filter->blocks);
+    free(filter);
+}
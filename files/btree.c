@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "include/cs165_api.h"
+#include "include/aggregate.h"
 
 BtreeNode* btree_create() {
     BtreeNode* root = malloc(sizeof(BtreeNode)); 
@@ -67,6 +68,121 @@ BtreeNode* get_leaf_node(BtreeIndex* index, int val) {
     return cur_node;
 }
 
+// the first key of the node not below val by binary search, the same slot find_key_pos_in_node scans for
+static int node_lower_bound(BtreeNode* node, int val) {
+    int* data = node->is_leaf ? node->data.leaf_data.data : node->data.internal_data.keys;
+    int low = 0;
+    int high = node->num_keys;
+    while(low < high) {
+        int mid = low + (high - low) / 2;
+        if(data[mid] < val) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// finds the leaf and the slot in it where the lookup of every key ends, as get_leaf_node would.
+// The lookups descend together one level at a time, so the nodes they load overlap, and every
+// child is prefetched while the other keys take their step.
+void btree_lower_bounds(BtreeIndex* index, int* keys, size_t num_keys, BtreeNode** leaves, int* slots) {
+    for(size_t i = 0; i < num_keys; i++) {
+        leaves[i] = index->btree_root;
+    }
+    bool descending = true;
+    while(descending) {
+        descending = false;
+        for(size_t i = 0; i < num_keys; i++) {
+            if(!leaves[i]->is_leaf) {
+                leaves[i] = leaves[i]->data.internal_data.children[node_lower_bound(leaves[i], keys[i])];
+                __builtin_prefetch(leaves[i]);
+                descending = true;
+            }
+        }
+    }
+    for(size_t i = 0; i < num_keys; i++) {
+        slots[i] = node_lower_bound(leaves[i], keys[i]);
+    }
+}
+
+BtreeNode* get_leftmost_leaf(BtreeIndex* index) {
+    BtreeNode* cur_node = index->btree_root; 
+    while(!cur_node->is_leaf) {
+        cur_node = cur_node->data.internal_data.children[0]; 
+    }
+    return cur_node;
+}
+
+// the smallest value sits first in the leftmost leaf, returns false for an empty index
+bool btree_min(BtreeIndex* index, int* min) {
+    BtreeNode* cur_node = get_leftmost_leaf(index);
+    while(cur_node != NULL && cur_node->num_keys == 0) {
+        cur_node = cur_node->data.leaf_data.next_leaf;
+    }
+    if(cur_node == NULL) {
+        return false;
+    }
+    *min = cur_node->data.leaf_data.data[0];
+    return true;
+}
+
+// the largest value sits last in the rightmost leaf, returns false for an empty index
+bool btree_max(BtreeIndex* index, int* max) {
+    BtreeNode* cur_node = index->btree_root; 
+    while(!cur_node->is_leaf) {
+        cur_node = cur_node->data.internal_data.children[cur_node->num_keys]; 
+    }
+    // a split leaves the right child last in the chain, follow it in case that ever changes
+    BtreeNode* last_node = NULL;
+    while(cur_node != NULL) {
+        if(cur_node->num_keys > 0) {
+            last_node = cur_node;
+        }
+        cur_node = cur_node->data.leaf_data.next_leaf;
+    }
+    if(last_node == NULL) {
+        return false;
+    }
+    *max = last_node->data.leaf_data.data[last_node->num_keys - 1];
+    return true;
+}
+
+// folds the indexed values the comparator qualifies into stats without producing their positions
+void aggregate_btree_range(BtreeIndex* index, Comparator* comparator, struct AggregateStats* stats) {
+    BtreeNode* cur_node;
+    if(comparator->type1 != NO_COMPARISON) {
+        cur_node = get_leaf_node(index, comparator->p_low);
+    }
+    else {
+        cur_node = get_leftmost_leaf(index);
+    }
+    while(cur_node != NULL) {
+        int* data = cur_node->data.leaf_data.data; 
+        int first = 0;
+        int last = cur_node->num_keys;
+        if(comparator->type1 != NO_COMPARISON) {
+            while(first < last && data[first] < comparator->p_low) {
+                first++;
+            }
+        }
+        bool done = false;
+        if(comparator->type2 != NO_COMPARISON) {
+            while(last > first && data[last - 1] >= comparator->p_high) {
+                last--;
+                done = true;
+            }
+        }
+        aggregate_values(data + first, last - first, stats);
+        if(done) {
+            return;
+        }
+        cur_node = cur_node->data.leaf_data.next_leaf; 
+    }
+}
+
 void select_from_btree_index(BtreeIndex* index, Comparator* comparator, Result* result) {
     int p_low = comparator->p_low;
     int p_high = comparator->p_high;
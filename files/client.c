@@ -182,6 +182,10 @@ void receive_data_to_print(int client_socket) {
     // place 0 for number of columns to prine, place 1 for if we have more than one row
     int print_meta[2]; 
     len = recv(client_socket, &recv_message, sizeof(message), 0);
+    // the server answers a print of a missing handle with the error alone
+    if(recv_message.status != OK_WAIT_FOR_RESPONSE) {
+        return;
+    }
     len = recv(client_socket, &print_meta, sizeof(int) * 2, 0); 
     send_message_to_socket(client_socket, &send_message);
     int num_columns = print_meta[0];
@@ -268,6 +272,63 @@ void receive_data_to_print(int client_socket) {
         }
         printf("\n");
     }
+    // multiple rows where some column is not an int, the types come first
+    else if(more_than_one == 2) {
+        int payload_types[num_columns]; 
+        size_t type_sizes[num_columns];
+        size_t row_size = 0;
+        len = recv(client_socket, &recv_message, sizeof(message), 0);
+        len = recv(client_socket, &payload_types, sizeof(int) * num_columns, 0); 
+        send_message_to_socket(client_socket, &send_message);
+        for(int j = 0; j < num_columns; j++) {
+            switch(payload_types[j]) {
+                case 1:
+                    type_sizes[j] = sizeof(long);
+                    break;
+                case 2:
+                    type_sizes[j] = sizeof(double);
+                    break;
+                default:
+                    type_sizes[j] = sizeof(int);
+                    break;
+            }
+            row_size += type_sizes[j];
+        }
+
+        while ((len = recv(client_socket, &recv_message, sizeof(message), 0)) > 0) {
+            int num_bytes = (int) recv_message.length;
+            if(num_bytes == -1) {
+                break;
+            }
+            int print_length = num_bytes / row_size; 
+            char* payload = malloc(num_bytes);
+
+            // the columns of the buffer follow each other
+            if ((len = recv(client_socket, payload, num_bytes, 0)) > 0) {
+                for(int i = 0; i < print_length; i++) {
+                    char* column = payload;
+                    for(int j = 0; j < num_columns; j++) {
+                        char* value = column + i * type_sizes[j];
+                        char* separator = j == num_columns - 1 ? "\n" : ",";
+                        switch(payload_types[j]) {
+                            case 1:
+                                printf("%ld%s", *(long*)value, separator);
+                                break;
+                            case 2:
+                                printf("%.2f%s", *(double*)value, separator);
+                                break;
+                            default:
+                                printf("%d%s", *(int*)value, separator);
+                                break;
+                        }
+                        column += print_length * type_sizes[j];
+                    }
+                }
+            }
+            free(payload);
+            send_message_to_socket(client_socket, &send_message);
+        }
+    }
     // we have multiple row to print, it must be columns of ints
     else {
         while ((len = recv(client_socket, &recv_message, sizeof(message), 0)) > 0) {
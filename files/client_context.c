@@ -42,7 +42,14 @@ Column* lookup_column(char* full_column_name) {
     char* table_name = strsep(&full_column_name, ".");
     char* column_name = full_column_name; 
 
+    // a name without the db.tbl.col dots is a handle that does not exist
+    if(column_name == NULL) {
+        return NULL;
+    }
     Table* table = lookup_table(table_name); 
+    if(table == NULL) {
+        return NULL;
+    }
     Column* column = lookup_column_in_table(table, column_name); 
     return column;
 }
@@ -62,8 +69,10 @@ void add_result_to_context(ClientContext* context, char* handle, Result* result)
     // look for the handle in the client context
     for(int i = 0; i < context->chandles_in_use; i++) {
         if(strcmp(context->chandle_table[i].name, handle) == 0) {
-            free_result(context->chandle_table[i].result);
+            // the handle may already hold the same (shared) result, release the old one last
+            Result* old_result = context->chandle_table[i].result;
             context->chandle_table[i].result = result; 
+            free_result(old_result);
             pthread_mutex_unlock(&context->mutex);
             return;
         }
@@ -85,3 +94,59 @@ void add_result_to_context(ClientContext* context, char* handle, Result* result)
     pthread_mutex_unlock(&context->mutex);
 }
 
+
+// returns the cached result of an operator with the same fingerprint, with a reference taken for 
+// the caller, or NULL if the client has no such result
+Result* lookup_cached_result(ClientContext* context, Fingerprint* fingerprint) {
+    Result* result = NULL;
+    pthread_mutex_lock(&context->mutex);
+    for(int i = 0; i < context->cached_results; i++) {
+        if(memcmp(&context->result_cache[i].fingerprint, fingerprint, sizeof(Fingerprint)) == 0) {
+            result = context->result_cache[i].result;
+            result->ref_count++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&context->mutex);
+    return result;
+}
+
+static size_t result_bytes(Result* result) {
+    if(result->payload_bytes != 0) {
+        return result->payload_bytes;
+    }
+    switch(result->data_type) {
+        case LONG:
+            return result->num_tuples * sizeof(long);
+        case DOUBLE:
+            return result->num_tuples * sizeof(double);
+        default:
+            return result->num_tuples * sizeof(int);
+    }
+}
+
+// keeps a reference to the result of the operator. The oldest entries are dropped until the new one
+// fits both the entry and the byte limit, a result larger than the whole byte limit is not cached.
+void cache_result(ClientContext* context, Fingerprint* fingerprint, Result* result) {
+    size_t bytes = result_bytes(result);
+    if(bytes > DEFAULT_RESULT_CACHE_BYTES) {
+        return;
+    }
+    pthread_mutex_lock(&context->mutex);
+    int num_evicted = 0;
+    while(context->cached_results - num_evicted == DEFAULT_RESULT_CACHE_SIZE ||
+          context->cached_bytes + bytes > DEFAULT_RESULT_CACHE_BYTES) {
+        CachedResult* evicted = &context->result_cache[num_evicted++];
+        context->cached_bytes -= evicted->bytes;
+        free_result(evicted->result);
+    }
+    context->cached_results -= num_evicted;
+    memmove(context->result_cache, context->result_cache + num_evicted, sizeof(CachedResult) * context->cached_results);
+    CachedResult* entry = &context->result_cache[context->cached_results++];
+    entry->fingerprint = *fingerprint;
+    entry->result = result;
+    entry->bytes = bytes;
+    result->ref_count++;
+    context->cached_bytes += bytes;
+    pthread_mutex_unlock(&context->mutex);
+}
@@ -0,0 +1,224 @@
+#define _DEFAULT_SOURCE
+#include <string.h>
+#include <time.h>
+
+#include "include/cost_model.h"
+#include "include/predicate_tree.h"
+#include "include/parallel.h"
+#include "include/utils.h"
+
+CostModel server_cost_model;
+pthread_once_t server_cost_model_calibrated = PTHREAD_ONCE_INIT;
+
+typedef struct CalibrationScan {
+    int* data;
+    size_t data_length;
+    Comparator** comparators;
+    Result* results;
+    size_t num_comparators;
+    PredicateTree* tree;
+} CalibrationScan;
+
+double get_wall_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// one shared scan of the comparators over data, in the same cache blocked way execute_select does
+void* calibration_scan(void* args) {
+    CalibrationScan* scan = (CalibrationScan*) args;
+    for(size_t ind = 0; ind < scan->num_comparators; ind++) {
+        scan->results[ind].num_tuples = 0;
+    }
+    Result* results[scan->num_comparators];
+    for(size_t ind = 0; ind < scan->num_comparators; ind++) {
+        results[ind] = &scan->results[ind];
+    }
+    for(size_t cur_loc = 0; cur_loc < scan->data_length; cur_loc += SELECT_VECTOR_SIZE) {
+        if(scan->tree != NULL) {
+            predicate_tree_select(scan->tree, scan->data, NULL, results, cur_loc, SELECT_VECTOR_SIZE, scan->data_length);
+            continue;
+        }
+        for(size_t ind = 0; ind < scan->num_comparators; ind++) {
+            select_unsorted_data_shared(scan->data, scan->comparators[ind], &scan->results[ind], 
+                                        cur_loc, SELECT_VECTOR_SIZE, scan->data_length);
+        }
+    }
+    return args;
+}
+
+double time_calibration_scans(CalibrationScan* scans, size_t num_scans) {
+    double start = get_wall_time();
+    run_tasks_in_parallel(calibration_scan, scans, sizeof(CalibrationScan), num_scans, num_scans);
+    return get_wall_time() - start;
+}
+
+// Times shared scans over a sample column larger than the caches: one scan with one comparator 
+// (the cost of reading the column), one scan with COST_MODEL_COMPARATORS comparators (the extra 
+// comparators only cost compute), the same comparators through a predicate tree, and one scan 
+// per core at the same time (shared memory bandwidth, up to COST_MODEL_MAX_PARALLEL_SCANS cores).
+void calibrate_cost_model(CostModel* model) {
+    model->num_cores = get_num_cores();
+    size_t data_length = COST_MODEL_SAMPLE_SIZE;
+    size_t num_data = model->num_cores < COST_MODEL_MAX_PARALLEL_SCANS ? model->num_cores : COST_MODEL_MAX_PARALLEL_SCANS;
+    model->parallel_scans_measured = num_data;
+    int** data = malloc(sizeof(int*) * num_data);
+    for(size_t j = 0; j < num_data; j++) {
+        data[j] = malloc(sizeof(int) * data_length);
+        for(size_t i = 0; i < data_length; i++) {
+            data[j][i] = (int)((i * 2654435761u) % data_length);
+        }
+    }
+
+    // every comparator selects roughly 1/1024 of the sample, the output buffers are sized with slack 
+    size_t range = data_length / 1024;
+    size_t num_results = COST_MODEL_COMPARATORS * num_data;
+    Comparator comparators[COST_MODEL_COMPARATORS];
+    Comparator* comparator_ptrs[COST_MODEL_COMPARATORS];
+    Result* results = malloc(sizeof(Result) * num_results);
+    for(size_t i = 0; i < COST_MODEL_COMPARATORS; i++) {
+        comparators[i].p_low = (i * range * 7) % (data_length - range);
+        comparators[i].p_high = comparators[i].p_low + range;
+        comparators[i].type1 = GREATER_THAN_OR_EQUAL;
+        comparators[i].type2 = LESS_THAN;
+        comparator_ptrs[i] = &comparators[i];
+    }
+    for(size_t i = 0; i < num_results; i++) {
+        results[i].payload = malloc(sizeof(int) * range * 4);
+        results[i].data_type = INT;
+    }
+
+    CalibrationScan* scans = malloc(sizeof(CalibrationScan) * num_data);
+    for(size_t j = 0; j < num_data; j++) {
+        scans[j].data = data[j];
+        scans[j].data_length = data_length;
+        scans[j].comparators = comparator_ptrs;
+        scans[j].results = &results[j * COST_MODEL_COMPARATORS];
+        scans[j].num_comparators = 1;
+        scans[j].tree = NULL;
+    }
+
+    // warm up the pages of the sample before timing anything
+    time_calibration_scans(scans, 1);
+    double single_time = time_calibration_scans(scans, 1);
+    double parallel_time = time_calibration_scans(scans, num_data);
+    scans[0].num_comparators = COST_MODEL_COMPARATORS;
+    double shared_time = time_calibration_scans(scans, 1);
+    scans[0].tree = predicate_tree_create(comparator_ptrs, COST_MODEL_COMPARATORS);
+    double tree_time = time_calibration_scans(scans, 1);
+    free_predicate_tree(scans[0].tree);
+
+    model->comparator_cost = (shared_time - single_time) / ((COST_MODEL_COMPARATORS - 1) * (double)data_length);
+    if(model->comparator_cost <= 0) {
+        model->comparator_cost = shared_time / (COST_MODEL_COMPARATORS * (double)data_length);
+    }
+    // reading the column is what is left of a single comparator scan 
+    model->scan_cost = single_time / data_length - model->comparator_cost;
+    if(model->scan_cost < model->comparator_cost / 8) {
+        model->scan_cost = model->comparator_cost / 8;
+    }
+    model->parallel_scan_cost = parallel_time / data_length - model->comparator_cost;
+    if(model->parallel_scan_cost < model->scan_cost) {
+        model->parallel_scan_cost = model->scan_cost;
+    }
+
+    model->predicate_tree_cost = (tree_time / data_length - model->scan_cost) / predicate_tree_depth(COST_MODEL_COMPARATORS);
+    if(model->predicate_tree_cost <= 0) {
+        model->predicate_tree_cost = model->comparator_cost;
+    }
+
+    for(size_t i = 0; i < num_results; i++) {
+        free(results[i].payload);
+    }
+    for(size_t j = 0; j < num_data; j++) {
+        free(data[j]);
+    }
+    free(results);
+    free(scans);
+    free(data);
+    cs165_log(stdout, "Cost model: scan %.3fns/int (%.3fns/int on %zu cores), comparator %.3fns/int, predicate tree level %.3fns/int\n", 
+              model->scan_cost * 1e9, model->parallel_scan_cost * 1e9, model->parallel_scans_measured, model->comparator_cost * 1e9, 
+              model->predicate_tree_cost * 1e9);
+}
+
+void calibrate_server_cost_model() {
+    calibrate_cost_model(&server_cost_model);
+}
+
+CostModel* get_cost_model() {
+    pthread_once(&server_cost_model_calibrated, calibrate_server_cost_model);
+    return &server_cost_model;
+}
+
+// Estimated time to answer num_queries comparators over a column of data_length ints using 
+// shared scans of queries_per_scan comparators, parallel_scans of them running at once. 
+// Scans running at once share the memory bandwidth, so the cost of reading the column grows 
+// from scan_cost with one scan to parallel_scan_cost with parallel_scans_measured scans, and stays there.
+double estimate_shared_scans_time(CostModel* model, size_t num_queries, size_t data_length, size_t queries_per_scan, size_t parallel_scans) {
+    size_t num_scans = (num_queries + queries_per_scan - 1) / queries_per_scan;
+    // the comparators are spread evenly over the scans
+    queries_per_scan = (num_queries + num_scans - 1) / num_scans;
+    if(parallel_scans > num_scans) {
+        parallel_scans = num_scans;
+    }
+    size_t waves = (num_scans + parallel_scans - 1) / parallel_scans;
+
+    double read_cost = model->parallel_scan_cost;
+    if(parallel_scans < model->parallel_scans_measured) {
+        read_cost = model->scan_cost + (model->parallel_scan_cost - model->scan_cost) * (parallel_scans - 1) / 
+                                       (model->parallel_scans_measured - 1);
+    }
+    return waves * (double)data_length * (read_cost + comparators_cost(model, queries_per_scan));
+}
+
+// cost per row of evaluating num_comparators comparators in a shared scan, one by one or through a predicate tree
+double comparators_cost(CostModel* model, size_t num_comparators) {
+    double linear_cost = num_comparators * model->comparator_cost;
+    double tree_cost = predicate_tree_depth(num_comparators) * model->predicate_tree_cost;
+    return linear_cost < tree_cost ? linear_cost : tree_cost;
+}
+
+bool use_predicate_tree(size_t num_comparators) {
+    CostModel* model = get_cost_model();
+    return num_comparators > 1 && 
+           predicate_tree_depth(num_comparators) * model->predicate_tree_cost < num_comparators * model->comparator_cost;
+}
+
+// Picks the number of comparators per shared scan and the number of scans to run in parallel
+// with the lowest estimated time for num_queries comparators on the same column.
+ScanPlan plan_shared_scans(size_t num_queries, size_t data_length) {
+    CostModel* model = get_cost_model();
+    ScanPlan best_plan;
+    best_plan.queries_per_scan = num_queries;
+    if(num_queries > DEFAULT_MAX_SHARED_SCANS && !use_predicate_tree(num_queries)) {
+        best_plan.queries_per_scan = DEFAULT_MAX_SHARED_SCANS;
+    }
+    best_plan.parallel_scans = 1;
+    if(num_queries == 0) {
+        best_plan.queries_per_scan = 1;
+        return best_plan;
+    }
+    double best_time = estimate_shared_scans_time(model, num_queries, data_length, best_plan.queries_per_scan, 1);
+
+    for(size_t num_scans = 1; num_scans <= num_queries; num_scans++) {
+        size_t queries_per_scan = (num_queries + num_scans - 1) / num_scans;
+        // comparators evaluated one by one write to too many outputs at once past this point
+        if(queries_per_scan > DEFAULT_MAX_SHARED_SCANS && !use_predicate_tree(queries_per_scan)) {
+            continue;
+        }
+        // only look at the smallest number of scans for every scan size
+        if(num_scans > 1 && (num_queries + num_scans - 2) / (num_scans - 1) == queries_per_scan) {
+            continue;
+        }
+        for(size_t parallel_scans = 1; parallel_scans <= model->num_cores && parallel_scans <= num_scans; parallel_scans++) {
+            double time = estimate_shared_scans_time(model, num_queries, data_length, queries_per_scan, parallel_scans);
+            if(time < best_time) {
+                best_time = time;
+                best_plan.queries_per_scan = queries_per_scan;
+                best_plan.parallel_scans = parallel_scans;
+            }
+        }
+    }
+    return best_plan;
+}
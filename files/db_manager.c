@@ -7,11 +7,18 @@
 #include <stdio.h>
 #include <pthread.h>
 #include <time.h>
+#include <math.h>
 
 #include "include/cs165_api.h"
 #include "include/utils.h"
 #include "include/client_context.h"
-#include "include/hashmap.h"
+#include "include/cost_model.h"
+#include "include/parallel.h"
+#include "include/predicate_tree.h"
+#include "include/aggregate.h"
+#include "include/group_by.h"
+#include "include/hyperloglog.h"
+#include "include/join.h"
 
 
 // In this class, there will always be only one active database at a time
@@ -38,6 +45,7 @@ Table* init_table() {
     new_table->col_capacity = 0;
     new_table->table_length = 0;
     new_table->table_capacity = 0;
+    new_table->version = 0;
     return new_table; 
 }
 
@@ -50,9 +58,47 @@ Column* init_column() {
     new_column->data = NULL;
     new_column->table = NULL;
     new_column->index = NULL;
+    new_column->prefix_sum = NULL;
+    new_column->sketch = NULL;
+    new_column->sorted = true;
     return new_column;
 }
 
+// result ids start at 1, a fingerprint with version 0 has no input
+size_t next_result_id = 1;
+pthread_mutex_t result_id_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+Result* init_result() {
+    Result* new_result = malloc(sizeof(Result));
+    if(new_result == NULL) {
+        return NULL;
+    }
+    new_result->num_tuples = 0;
+    new_result->data_type = INT;
+    new_result->payload = NULL;
+    new_result->payload_bytes = 0;
+    new_result->ref_count = 1;
+    new_result->sorted = false;
+    pthread_mutex_lock(&result_id_mutex);
+    new_result->id = next_result_id++;
+    pthread_mutex_unlock(&result_id_mutex);
+    return new_result;
+}
+
+// frees the comparators of the join sides that are scanned
+void free_join_selects(JoinOperator* join) {
+    Comparator* selects[2] = {join->select1, join->select2};
+    for(int i = 0; i < 2; i++) {
+        if(selects[i] != NULL) {
+            free(selects[i]->gen_col);
+            if(selects[i]->vec_pos != NULL) {
+                free(selects[i]->vec_pos);
+            }
+            free(selects[i]);
+        }
+    }
+}
+
 void free_db_operator(DbOperator* dbo) {
     switch(dbo->type) {
         case CREATE:
@@ -76,14 +122,14 @@ void free_db_operator(DbOperator* dbo) {
         }    
         case FETCH:
         {
-            GeneralizedColumn* col1 = dbo->operator_fields.fetch_operator.col1;
-            GeneralizedColumn* col2 = dbo->operator_fields.fetch_operator.col2;
-            if(col1 != NULL) {
-                free(col1);
-            }
-            if(col2 != NULL) {
-                free(col2);
+            FetchOperator* fetch_operator = &dbo->operator_fields.fetch_operator;
+            for(size_t i = 0; i < fetch_operator->num_cols; i++) {
+                free(fetch_operator->cols[i]);
+                free(fetch_operator->handles[i]);
             }
+            free(fetch_operator->cols);
+            free(fetch_operator->handles);
+            free(fetch_operator->pos_vec);
             break;
         } 
         case SHUTDOWN:
@@ -121,11 +167,35 @@ void free_db_operator(DbOperator* dbo) {
                     free(cur_select->comparators[j]);
                 }
                 free(cur_select->comparators);
+                free(cur_select);
             }
             free(batch_operator->selects);
             break;
         }
         case JOIN:
+            free_join_selects(&dbo->operator_fields.join_operator);
+            break;
+        case PIPELINE:
+        {
+            Comparator* comparator = dbo->operator_fields.pipeline_operator.comparator;
+            free(comparator->gen_col);
+            if(comparator->vec_pos != NULL) {
+                free(comparator->vec_pos);
+            }
+            free(comparator);
+            free(dbo->operator_fields.pipeline_operator.fetch_col);
+            break;
+        }
+        case GROUP_BY:
+            free(dbo->operator_fields.group_by_operator.keys);
+            free(dbo->operator_fields.group_by_operator.values);
+            break;
+        case SORT:
+        case TOPK:
+            free(dbo->operator_fields.sort_operator.positions);
+            free(dbo->operator_fields.sort_operator.values);
+            break;
+        case MULTI_JOIN:
             break;
     }        
 
@@ -269,6 +339,55 @@ void increase_column_size(Column* column, size_t old_size, size_t new_size) {
     }
 }
 
+PrefixSum* create_prefix_sum() {
+    PrefixSum* prefix_sum = malloc(sizeof(PrefixSum));
+    prefix_sum->capacity = DEFAULT_TABLE_CAPACITY + 1;
+    prefix_sum->sums = malloc(sizeof(long) * prefix_sum->capacity);
+    prefix_sum->sums[0] = 0;
+    prefix_sum->valid_length = 0;
+    return prefix_sum;
+}
+
+// a value changed at pos, the sums of the positions after it are stale
+void invalidate_prefix_sum(Column* column, size_t pos) {
+    if(column->prefix_sum != NULL && column->prefix_sum->valid_length > pos) {
+        column->prefix_sum->valid_length = pos;
+    }
+}
+
+// a value inserted at pos keeps the column sorted if it fits between its neighbours
+void update_column_sorted(Column* column, size_t pos) {
+    size_t col_len = column->table->table_length;
+    int* data = column->data;
+    column->sorted = column->sorted && (pos == 0 || data[pos - 1] <= data[pos]) && 
+                     (pos == col_len || data[pos] <= data[pos + 1]);
+}
+
+// the sketch only ever grows, so an insert just adds its value
+void add_to_sketch(Column* column, int val) {
+    if(column->sketch != NULL) {
+        hyperloglog_add(column->sketch, val);
+    }
+}
+
+// returns the sum of the values at positions [first, last), rebuilding the stale sums it needs
+long prefix_range_sum(Column* column, size_t first, size_t last) {
+    PrefixSum* prefix_sum = column->prefix_sum;
+    if(prefix_sum->capacity < column->table->table_length + 1) {
+        prefix_sum->capacity = column->table->table_length + 1;
+        prefix_sum->sums = realloc(prefix_sum->sums, sizeof(long) * prefix_sum->capacity);
+    }
+    if(prefix_sum->valid_length < last) {
+        long* sums = prefix_sum->sums;
+        // rebuild to the end of the column, appends then only ever rebuild what they added
+        for(size_t i = prefix_sum->valid_length; i < column->table->table_length; i++) {
+            sums[i + 1] = sums[i] + column->data[i];
+        }
+        prefix_sum->valid_length = column->table->table_length;
+    }
+    return prefix_sum->sums[last] - prefix_sum->sums[first];
+}
+
 void insert_to_array_in_position(int* data,  int val, size_t pos, size_t data_len) {
     size_t i = data_len; 
     while (i > pos) {
@@ -278,14 +397,6 @@ void insert_to_array_in_position(int* data,  int val, size_t pos, size_t data_le
     data[i] = val; 
 }
 
-void insert_to_sorted_data(int* data, size_t len, int val) {
-    size_t i; 
-    for(i = len; i > 0 && data[i-1] > val; i--) {
-        data[i] = data[i - 1];
-    }
-    data[i] = val; 
-}
-
 // this function inserts the value to an unclustered index on a column.
 // it take as input orig_pos, the position in the original column data in which the new value was stored
 // The function needs to iterate on all positions and update the index of any value whose
@@ -364,11 +475,17 @@ void insert_to_clustered_column(Column* column, int val, size_t* pos, bool inser
     // in the clustered table
     if(!insert_pos) {
         column->data[col_len] = val;  
+        invalidate_prefix_sum(column, col_len);
+        add_to_sketch(column, val);
+        update_column_sorted(column, col_len);
         *pos = insert_to_clustered_index(column->index, val, col_len);
     }
     // in this case we need to insert to the column in a specific location 
     else {
         insert_to_array_in_position(column->data, val, *pos, col_len);
+        invalidate_prefix_sum(column, *pos);
+        add_to_sketch(column, val);
+        update_column_sorted(column, *pos);
         if(column->index != NULL) {
             insert_to_unclustered_index(column->index, val, *pos, col_len);
         }
@@ -380,9 +497,12 @@ void insert_to_unclustered_column(Column* column, int val) {
     size_t col_len = column->table->table_length; 
 
     column->data[col_len] = val;  
+    invalidate_prefix_sum(column, col_len);
+    add_to_sketch(column, val);
+    update_column_sorted(column, col_len);
     if(column->index != NULL) {
         // pass col_len as the position to which the value was inserted in the column
-        insert_to_unclustered_index(column->index, col_len, val, col_len);
+        insert_to_unclustered_index(column->index, val, col_len, col_len);
     }
 }
 
@@ -392,6 +512,7 @@ void insert_to_unclustered_table(Table* table, int* values) {
         insert_to_unclustered_column(table->columns[i], values[i]);
     }
     table->table_length++;
+    table->version++;
 }
 
 // insert to table with clustered index
@@ -408,6 +529,7 @@ void insert_to_clustered_table(Table* table, int* values) {
         }
     }   
     table->table_length++;
+    table->version++;
 }
 
 void execute_insert(DbOperator* query) {
@@ -466,7 +588,11 @@ void execute_load(char* data) {
 }
 
 /* Free operators to be used on shutdown */ 
+// results are shared between handles and the result cache, the last reference frees them
 void free_result(Result* result) {
+    if(--result->ref_count > 0) {
+        return;
+    }
     free(result->payload);
     free(result); 
 }
@@ -475,6 +601,13 @@ void free_client_context(ClientContext* context) {
     for(int i = 0; i < context->chandles_in_use; i++) {
         free_result(context->chandle_table[i].result); 
     }
+    for(int i = 0; i < context->cached_results; i++) {
+        free_result(context->result_cache[i].result);
+    }
+    for(int i = 0; i < context->deferred_in_use; i++) {
+        free(context->deferred_queries[i].query);
+    }
+    free(context->deferred_queries);
     free(context->chandle_table);
     free(context);
 }
@@ -492,6 +625,11 @@ void free_column(Column* column) {
             free(column->index);
         }
     }
+    if(column->prefix_sum != NULL) {
+        free(column->prefix_sum->sums);
+        free(column->prefix_sum);
+    }
+    free(column->sketch);
     free(column);
 }
 
@@ -610,6 +748,26 @@ void write_column_to_disk(Column* column, Table* table, char* dir) {
     if(column->index != NULL) {
         write_index_to_disk(column, full_file_name);
     }
+    char sketch_file_name[PATH_MAX];
+    strcpy(sketch_file_name, full_file_name);
+    strcat(sketch_file_name, ".sketch");
+    if(column->sketch != NULL) {
+        fp = fopen(sketch_file_name, "w");
+        fwrite(column->sketch->registers, sizeof(column->sketch->registers), 1, fp);
+        fclose(fp);
+    }
+    else {
+        remove(sketch_file_name);
+    }
+    // the sums are rebuilt from the data on first use, only their existence is stored
+    strcat(full_file_name, ".prefix_sum");
+    if(column->prefix_sum != NULL) {
+        fp = fopen(full_file_name, "w");
+        fclose(fp);
+    }
+    else {
+        remove(full_file_name);
+    }
 }
 
 
@@ -762,84 +920,246 @@ Column* load_column_from_disk(char* column_name, char* dir, Table* table) {
     }
     fread(new_column->data, sizeof(int), table->table_length, fp); 
     fclose(fp);
+    for(size_t i = 1; i < table->table_length && new_column->sorted; i++) {
+        new_column->sorted = new_column->data[i - 1] <= new_column->data[i];
+    }
 
     new_column->index = load_index_from_disk(full_file_name, new_column);
 
+    char sketch_file_name[PATH_MAX];
+    strcpy(sketch_file_name, full_file_name);
+    strcat(sketch_file_name, ".sketch");
+    fp = fopen(sketch_file_name, "r");
+    if(fp != NULL) {
+        new_column->sketch = create_hyperloglog();
+        fread(new_column->sketch->registers, sizeof(new_column->sketch->registers), 1, fp);
+        fclose(fp);
+    }
+
+    struct stat prefix_sum_marker;
+    strcat(full_file_name, ".prefix_sum");
+    if(stat(full_file_name, &prefix_sum_marker) == 0) {
+        new_column->prefix_sum = create_prefix_sum();
+    }
+
     return new_column;
 }
 
 void* thread_select(void* args) {
     ThreadSelect* cast_arg = (ThreadSelect*) args;
-    execute_select(cast_arg->select, cast_arg->context);
+    select_comparators(cast_arg->select->comparators, cast_arg->select->comparators_length, cast_arg->results);
     return (void*)args;
 }
 
+// a column input is versioned by its table, a result input by its id
+void fingerprint_input(Fingerprint* fingerprint, size_t input, GeneralizedColumn* gen_col) {
+    if(gen_col == NULL) {
+        return;
+    }
+    if(gen_col->column_type == COLUMN) {
+        fingerprint->inputs[input] = gen_col->column_pointer.column;
+        fingerprint->versions[input] = gen_col->column_pointer.column->table->version;
+    }
+    else {
+        fingerprint->inputs[input] = NULL;
+        fingerprint->versions[input] = gen_col->column_pointer.result->id;
+    }
+}
+
+void init_fingerprint(Fingerprint* fingerprint, OperatorType operator_type, AggregateType aggregate_type, 
+                      GeneralizedColumn* col1, GeneralizedColumn* col2) {
+    // fingerprints are compared byte by byte, so the padding has to be cleared as well
+    memset(fingerprint, 0, sizeof(Fingerprint));
+    fingerprint->operator_type = operator_type;
+    fingerprint->aggregate_type = aggregate_type;
+    fingerprint_input(fingerprint, 0, col1);
+    fingerprint_input(fingerprint, 1, col2);
+}
+
+// a bound without a comparison is left zero, whatever the comparator holds there
+void fingerprint_comparator(Fingerprint* fingerprint, Comparator* comparator) {
+    fingerprint->type1 = comparator->type1;
+    fingerprint->type2 = comparator->type2;
+    fingerprint->p_low = comparator->type1 == NO_COMPARISON ? 0 : comparator->p_low;
+    fingerprint->p_high = comparator->type2 == NO_COMPARISON ? 0 : comparator->p_high;
+}
+
+void init_select_fingerprint(Fingerprint* fingerprint, Comparator* comparator) {
+    init_fingerprint(fingerprint, SELECT, 0, comparator->gen_col, comparator->vec_pos);
+    fingerprint_comparator(fingerprint, comparator);
+}
+
+// shares the cached result of the operator with the handle, returns false when there is none
+bool reuse_cached_result(ClientContext* context, Fingerprint* fingerprint, char* handle) {
+    Result* result = lookup_cached_result(context, fingerprint);
+    if(result == NULL) {
+        return false;
+    }
+    add_result_to_context(context, handle, result);
+    return true;
+}
+
+void cache_and_add_result(ClientContext* context, Fingerprint* fingerprint, char* handle, Result* result) {
+    cache_result(context, fingerprint, result);
+    add_result_to_context(context, handle, result);
+}
+
+void find_common_selects(SelectOperator* select, ClientContext* context, CommonSelects* common) {
+    size_t num_comparators = select->comparators_length;
+    common->cached = malloc(sizeof(Result*) * num_comparators);
+    common->unique_of = malloc(sizeof(size_t) * num_comparators);
+    common->unique = malloc(sizeof(Comparator*) * num_comparators);
+    common->fingerprints = malloc(sizeof(Fingerprint) * num_comparators);
+    common->results = malloc(sizeof(Result*) * num_comparators);
+    common->num_unique = 0;
+
+    for(size_t i = 0; i < num_comparators; i++) {
+        Fingerprint fingerprint;
+        init_select_fingerprint(&fingerprint, select->comparators[i]);
+        common->cached[i] = lookup_cached_result(context, &fingerprint);
+        if(common->cached[i] != NULL) {
+            continue;
+        }
+        size_t j = 0;
+        while(j < common->num_unique && memcmp(&common->fingerprints[j], &fingerprint, sizeof(Fingerprint)) != 0) {
+            j++;
+        }
+        if(j == common->num_unique) {
+            common->fingerprints[j] = fingerprint;
+            common->unique[j] = select->comparators[i];
+            common->num_unique++;
+        }
+        common->unique_of[i] = j;
+    }
+}
+
+// places the results in the handles in the order of the comparators and caches the new ones
+void add_select_results_to_context(SelectOperator* select, ClientContext* context, CommonSelects* common) {
+    // every handle sharing a new result holds a reference to it
+    for(size_t j = 0; j < common->num_unique; j++) {
+        common->results[j]->ref_count = 0;
+    }
+    for(size_t i = 0; i < select->comparators_length; i++) {
+        if(common->cached[i] == NULL) {
+            common->results[common->unique_of[i]]->ref_count++;
+        }
+    }
+    for(size_t j = 0; j < common->num_unique; j++) {
+        cache_result(context, &common->fingerprints[j], common->results[j]);
+    }
+    for(size_t i = 0; i < select->comparators_length; i++) {
+        Result* result = common->cached[i];
+        if(result == NULL) {
+            result = common->results[common->unique_of[i]];
+        }
+        add_result_to_context(context, select->comparators[i]->handle, result);
+    }
+}
+
+void free_common_selects(CommonSelects* common) {
+    free(common->cached);
+    free(common->unique_of);
+    free(common->unique);
+    free(common->fingerprints);
+    free(common->results);
+}
+
+// returns the number of rows a select on the comparator has to scan
+size_t get_comparator_data_length(Comparator* comparator) {
+    if(comparator->gen_col->column_type == COLUMN) {
+        return comparator->gen_col->column_pointer.column->table->table_length;
+    }
+    return comparator->gen_col->column_pointer.result->num_tuples;
+}
+
+// writes the positions among the SELECT_VECTOR_SIZE rows from cur_loc that the comparator
+// qualifies to positions, which has room for a vector
+void select_vector(Comparator* comparator, size_t cur_loc, Result* positions) {
+    int* data;
+    size_t data_length = get_comparator_data_length(comparator);
+    if(comparator->gen_col->column_type == COLUMN) {
+        data = comparator->gen_col->column_pointer.column->data;
+    }
+    else {
+        data = comparator->gen_col->column_pointer.result->payload;
+    }
+    positions->num_tuples = 0;
+    if(comparator->vec_pos == NULL) {
+        select_unsorted_data_shared(data, comparator, positions, cur_loc, SELECT_VECTOR_SIZE, data_length);
+        return;
+    }
+    int* pos_vec_data;
+    if(comparator->vec_pos->column_type == COLUMN) {
+        pos_vec_data = comparator->vec_pos->column_pointer.column->data;
+    }
+    else {
+        pos_vec_data = comparator->vec_pos->column_pointer.result->payload;
+    }
+    select_unsorted_data_with_pos_vec_shared(data, pos_vec_data, comparator, positions, cur_loc, SELECT_VECTOR_SIZE, data_length);
+}
+
 void execute_batch_queries(DbOperator* query) {
     BatchOperator batch_operator = query->operator_fields.batch_operator;
-    size_t num_selects = batch_operator.selects_length;
-    pthread_t threads[num_selects];
-    ThreadSelect args[num_selects];
-
-    for(size_t j = 0; j < num_selects; j+=MAX_SELECT_THREADS) {
-        for(size_t i = j; i < j + MAX_SELECT_THREADS && i < num_selects; i++) {
-            args[i].select = batch_operator.selects[i];
-            args[i].context = query->context; 
-            pthread_create(&threads[i], NULL, thread_select, (void*)(&args[i]));
-        }
-        for(size_t i = j; i < j + MAX_SELECT_THREADS && i < num_selects; i++) {
-            pthread_join(threads[i], NULL);
-        }
-    }
-}
-
-void execute_join(DbOperator* query) {
-    ClientContext* context = query->context; 
-    JoinOperator join = query->operator_fields.join_operator;
-    Result* result1 = malloc(sizeof(Result)); 
-    result1->payload = malloc(sizeof(int) * join.val_vec1->num_tuples);
-    result1->num_tuples = 0; 
-    Result* result2 = malloc(sizeof(Result)); 
-    result2->payload = malloc(sizeof(int) * join.val_vec2->num_tuples);
-    result2->num_tuples = 0; 
-
-    if(join.type == HASH) {
-        Hashmap* hashmap = hashmap_create(); 
-        // insert all the values from the first key-pos pair into the hash table
-        for(size_t i = 0; i < join.val_vec1->num_tuples; i++) {
-            hashmap_put(hashmap, ((int*)join.val_vec1->payload)[i], ((int*)join.pos_vec1->payload)[i]); 
-        }
-        // probe the hashtable and update results when found match 
-        for(size_t i = 0; i < join.val_vec2->num_tuples; i++) {
-            int pos1 = hashmap_get(hashmap, ((int*)join.val_vec2->payload)[i]);  
-            if(pos1 != -1) {
-                insert_to_sorted_data((int*)result1->payload, result1->num_tuples, pos1); 
-                result1->num_tuples++; 
-                insert_to_sorted_data((int*)result2->payload, result2->num_tuples, ((int*)join.pos_vec2->payload)[i]); 
-                result2->num_tuples++; 
-            } 
-        }
-    }
-    else if (join.type == NESTED) {
-        size_t vector_size = 1024; 
-        for(size_t i = 0; i < join.val_vec1->num_tuples; i+=vector_size) {
-            for(size_t j = 0; j < join.val_vec2->num_tuples; j+=vector_size) {
-                for(size_t r = i; r < i + vector_size && r < join.val_vec1->num_tuples; r++) {
-                    for(size_t m = j; m < j + vector_size && m < join.val_vec2->num_tuples; m++) {
-                        if(((int*)join.val_vec1->payload)[r] == ((int*)join.val_vec2->payload)[m]) {
-                            insert_to_sorted_data((int*)result1->payload, result1->num_tuples, ((int*)join.pos_vec1->payload)[r]); 
-                            result1->num_tuples++; 
-                            insert_to_sorted_data((int*)result2->payload, result2->num_tuples, ((int*)join.pos_vec2->payload)[m]); 
-                            result2->num_tuples++; 
-                        }
 
-                    }
-                
-                }
-            }
+    // the parser already grouped the comparators by the column (and position vector) they scan.
+    // Only the comparators without a cached result are evaluated, and identical ones only once.
+    // the cost model decides for every group how many comparators share a scan and how many of 
+    // its scans should run in parallel. Selects that can use an index on the column run one by one, 
+    // the index is cheaper than any scan.
+    CommonSelects common[batch_operator.selects_length];
+    ScanPlan plans[batch_operator.selects_length];
+    size_t num_scans = 0;
+    size_t num_threads = 1;
+    for(size_t i = 0; i < batch_operator.selects_length; i++) {
+        find_common_selects(batch_operator.selects[i], query->context, &common[i]);
+        size_t num_unique = common[i].num_unique;
+        if(num_unique == 0) {
+            plans[i].queries_per_scan = 1;
+            plans[i].parallel_scans = 1;
+            continue;
+        }
+        Comparator* comparator = common[i].unique[0];
+        if(comparator->vec_pos == NULL && comparator->gen_col->column_type == COLUMN &&
+           comparator->gen_col->column_pointer.column->index != NULL) {
+            plans[i].queries_per_scan = 1;
+            plans[i].parallel_scans = get_cost_model()->num_cores;
+        }
+        else {
+            plans[i] = plan_shared_scans(num_unique, get_comparator_data_length(comparator));
+        }
+        num_scans += (num_unique + plans[i].queries_per_scan - 1) / plans[i].queries_per_scan;
+        if(plans[i].parallel_scans > num_threads) {
+            num_threads = plans[i].parallel_scans;
         }
     }
-    add_result_to_context(context, join.handle1, result1);
-    add_result_to_context(context, join.handle2, result2);
+
+    ThreadSelect* scans = malloc(sizeof(ThreadSelect) * num_scans);
+    SelectOperator* scan_selects = malloc(sizeof(SelectOperator) * num_scans);
+    size_t cur_scan = 0;
+    for(size_t i = 0; i < batch_operator.selects_length; i++) {
+        size_t num_unique = common[i].num_unique;
+        size_t num_group_scans = (num_unique + plans[i].queries_per_scan - 1) / plans[i].queries_per_scan;
+        for(size_t j = 0; j < num_group_scans; j++) {
+            // spread the comparators evenly, the scans only point into the unique comparators of the group
+            size_t first = num_unique * j / num_group_scans;
+            size_t last = num_unique * (j + 1) / num_group_scans;
+            scan_selects[cur_scan].comparators = &common[i].unique[first];
+            scan_selects[cur_scan].comparators_length = last - first;
+            scan_selects[cur_scan].comparators_capacity = last - first;
+            scans[cur_scan].select = &scan_selects[cur_scan];
+            scans[cur_scan].results = &common[i].results[first];
+            cur_scan++;
+        }
+    }
+
+    run_tasks_in_parallel(thread_select, scans, sizeof(ThreadSelect), num_scans, num_threads);
+    free(scan_selects);
+    free(scans);
+
+    for(size_t i = 0; i < batch_operator.selects_length; i++) {
+        add_select_results_to_context(batch_operator.selects[i], query->context, &common[i]);
+        free_common_selects(&common[i]);
+    }
 }
 
 char* execute_db_operator(DbOperator* query) {
@@ -901,6 +1221,21 @@ char* execute_db_operator(DbOperator* query) {
         case JOIN:
             execute_join(query);
             break;
+        case PIPELINE:
+            execute_pipeline(query);
+            break;
+        case GROUP_BY:
+            execute_group_by(query);
+            break;
+        case SORT:
+            execute_sort(query);
+            break;
+        case TOPK:
+            execute_topk(query);
+            break;
+        case MULTI_JOIN:
+            execute_multi_join(query);
+            break;
     }
     free_db_operator(query);
     return NULL;
@@ -1098,6 +1433,98 @@ void select_from_sorted_index(SortedIndex* index, Comparator* comparator, Result
     select_sorted_data_with_pos_vec(index->data, index->indices, comparator, result, start_pos, data_len);
 }
 
+// returns the first position in the sorted data whose value is not below val
+size_t sorted_lower_bound(int* data, size_t data_len, long val) {
+    size_t low = 0;
+    size_t high = data_len;
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+        if(data[mid] < val) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// the binary searches of all the keys advance together, one halving step for every key at a time,
+// so the loads of different keys overlap. Every step prefetches both entries the next step of a
+// search can read.
+void sorted_index_lower_bounds(SortedIndex* index, size_t data_len, int* keys, size_t num_keys, size_t* firsts) {
+    int* data = index->data;
+    for(size_t i = 0; i < num_keys; i++) {
+        firsts[i] = 0;
+    }
+    if(data_len == 0) {
+        return;
+    }
+    size_t remaining = data_len;
+    while(remaining > 1) {
+        size_t half = remaining / 2;
+        size_t next_half = (remaining - half) / 2;
+        for(size_t i = 0; i < num_keys; i++) {
+            __builtin_prefetch(&data[firsts[i] + next_half]);
+            __builtin_prefetch(&data[firsts[i] + half + next_half]);
+            firsts[i] = data[firsts[i] + half] < keys[i] ? firsts[i] + half : firsts[i];
+        }
+        remaining -= half;
+    }
+    for(size_t i = 0; i < num_keys; i++) {
+        firsts[i] += data[firsts[i]] < keys[i] ? 1 : 0;
+    }
+}
+
+// the values of a sorted index the comparator qualifies are data[*first, *last), found by binary search
+void find_sorted_index_range(SortedIndex* index, Comparator* comparator, size_t data_len, size_t* first, size_t* last) {
+    *first = 0;
+    *last = data_len;
+    if(comparator->type1 != NO_COMPARISON) {
+        *first = sorted_lower_bound(index->data, data_len, comparator->p_low);
+    }
+    if(comparator->type2 != NO_COMPARISON) {
+        *last = sorted_lower_bound(index->data, data_len, comparator->p_high);
+    }
+    if(*last < *first) {
+        *last = *first;
+    }
+}
+
+// min and max of an indexed column sit at the ends of the index, returns false for an empty column
+bool index_min_max(ColumnIndex* index, size_t data_len, bool min, int* value) {
+    if(index->type == SORTED) {
+        if(data_len == 0) {
+            return false;
+        }
+        *value = min ? index->index_fields.sorted_index.data[0] : index->index_fields.sorted_index.data[data_len - 1];
+        return true;
+    }
+    if(min) {
+        return btree_min(&index->index_fields.btree_index, value);
+    }
+    return btree_max(&index->index_fields.btree_index, value);
+}
+
+// aggregates the qualifying values of an indexed column straight from the index.
+// A count over a sorted index only needs the bounds of the range.
+void aggregate_index_range(ColumnIndex* index, Comparator* comparator, size_t data_len, AggregateType type, AggregateStats* stats) {
+    if(index->type == SORTED) {
+        size_t first;
+        size_t last;
+        find_sorted_index_range(&index->index_fields.sorted_index, comparator, data_len, &first, &last);
+        if(type == COUNT) {
+            stats->count += last - first;
+        }
+        else {
+            aggregate_values(index->index_fields.sorted_index.data + first, last - first, stats);
+        }
+    }
+    else {
+        aggregate_btree_range(&index->index_fields.btree_index, comparator, stats);
+    }
+}
+
 void select_from_index(ColumnIndex* index, Comparator* comparator, Result* result, size_t data_len) {
     if(index->type == SORTED) {
         select_from_sorted_index(&index->index_fields.sorted_index, comparator, result, data_len); 
@@ -1108,9 +1535,18 @@ void select_from_index(ColumnIndex* index, Comparator* comparator, Result* resul
 }
 
 void execute_select(SelectOperator* select_operator, ClientContext* context) {
-    Comparator** comparators = select_operator->comparators;
-    size_t num_comparators = select_operator->comparators_length;
-    
+    CommonSelects common;
+    find_common_selects(select_operator, context, &common);
+    select_comparators(common.unique, common.num_unique, common.results);
+    add_select_results_to_context(select_operator, context, &common);
+    free_common_selects(&common);
+}
+
+// evaluates the comparators, which all select from the same column (and position vector)
+void select_comparators(Comparator** comparators, size_t num_comparators, Result** results) {
+    if(num_comparators == 0) {
+        return;
+    }
     // only handle selects from index when we don't have shared scans
     if(num_comparators == 1) {
         Comparator* comparator = comparators[0]; 
@@ -1127,9 +1563,7 @@ void execute_select(SelectOperator* select_operator, ClientContext* context) {
             }
         }
 
-        Result* result =  malloc(sizeof(Result));
-        result->num_tuples = 0;
-        result->data_type = INT;
+        Result* result = init_result();
 
         if(col_vec->column_type == COLUMN) {
             Column* column = col_vec->column_pointer.column;
@@ -1162,16 +1596,13 @@ void execute_select(SelectOperator* select_operator, ClientContext* context) {
                 select_unsorted_data(res->payload, comparator, result, data_len);
             }
         }
-        add_result_to_context(context, comparator->handle, result);
+        results[0] = result;
     }
     // shared scans case
     else {
         int* col_vec_data;
         int* pos_vec_data = NULL;
         size_t data_length = 0;
-        // create arrays to hold data per comparator
-        char* handles[num_comparators];
-        Result* results[num_comparators];
 
         GeneralizedColumn* col_vec = comparators[0]->gen_col;
         if(col_vec->column_type == COLUMN) {
@@ -1193,18 +1624,36 @@ void execute_select(SelectOperator* select_operator, ClientContext* context) {
             }
         }
 
-        for(size_t ind = 0; ind < num_comparators; ind++) {
-            handles[ind] = comparators[ind]->handle;
+        // with many comparators every row looks up the ones it satisfies in a predicate tree,
+        // identical comparators are evaluated once and share their result
+        PredicateTree* tree = NULL;
+        size_t num_scan_results = num_comparators;
+        if(use_predicate_tree(num_comparators)) {
+            tree = predicate_tree_create(comparators, num_comparators);
+            num_scan_results = tree->num_predicates;
+        }
 
-            results[ind] = malloc(sizeof(Result));
-            results[ind]->payload = malloc(sizeof(int) * data_length);
-            results[ind]->num_tuples = 0;
-            results[ind]->data_type = INT;
+        Result* scan_results[num_scan_results];
+        for(size_t ind = 0; ind < num_scan_results; ind++) {
+            scan_results[ind] = init_result();
+            scan_results[ind]->payload = malloc(sizeof(int) * data_length);
         }
 
         int vector_size = SELECT_VECTOR_SIZE; 
+        if(tree != NULL) {
+            for(size_t cur_loc = 0; cur_loc < data_length; cur_loc += vector_size) {
+                predicate_tree_select(tree, col_vec_data, pos_vec_data, scan_results, cur_loc, vector_size, data_length);
+            }
+            for(size_t ind = 0; ind < num_comparators; ind++) {
+                results[ind] = scan_results[tree->comparator_predicates[ind]];
+            }
+            free_predicate_tree(tree);
+        }
         // 3 arguments case
-        if(pos_vec_data == NULL) {
+        else if(pos_vec_data == NULL) {
+            for(size_t ind = 0; ind < num_comparators; ind++) {
+                results[ind] = scan_results[ind];
+            }
             for(size_t cur_loc = 0; cur_loc < data_length; cur_loc += vector_size) {
                 for(size_t ind = 0; ind < num_comparators; ind++) {
                     select_unsorted_data_shared(col_vec_data, comparators[ind], results[ind], cur_loc, vector_size, data_length);
@@ -1213,33 +1662,193 @@ void execute_select(SelectOperator* select_operator, ClientContext* context) {
         }
         // four arguments case
         else {
+            for(size_t ind = 0; ind < num_comparators; ind++) {
+                results[ind] = scan_results[ind];
+            }
             for(size_t cur_loc = 0; cur_loc < data_length; cur_loc += vector_size) {
                 for(size_t ind = 0; ind < num_comparators; ind++) {
                     select_unsorted_data_with_pos_vec_shared(col_vec_data, pos_vec_data, comparators[ind], results[ind], cur_loc, vector_size, data_length);
                 }
             }
         }
-        for(size_t ind = 0; ind < num_comparators; ind++) {
-            add_result_to_context(context, handles[ind], results[ind]);
+        for(size_t ind = 0; ind < num_scan_results; ind++) {
+            // the buffers were sized for the whole column, give back what the selection didn't use. An
+            // empty selection keeps one slot, realloc to 0 bytes may free the buffer.
+            size_t num_kept = scan_results[ind]->num_tuples > 0 ? scan_results[ind]->num_tuples : 1;
+            if(num_kept < data_length) {
+                scan_results[ind]->payload = realloc(scan_results[ind]->payload, sizeof(int) * num_kept);
+            }
+        }
+    }
+}
+
+PositionOrder get_position_order(int* positions, size_t num_positions) {
+    PositionOrder order = CONTIGUOUS_POSITIONS;
+    for(size_t i = 1; i < num_positions; i++) {
+        if(positions[i] < positions[i - 1]) {
+            return RANDOM_POSITIONS;
+        }
+        if(positions[i] != positions[i - 1] + 1) {
+            order = SORTED_POSITIONS;
         }
     }
+    return order;
+}
+
+void fetch_values(int* data, int* positions, size_t num_positions, int* values) {
+    fetch_values_in_order(data, positions, num_positions, values, get_position_order(positions, num_positions));
+}
+
+void fetch_values_in_order(int* data, int* positions, size_t num_positions, int* values, PositionOrder order) {
+    size_t i = 0;
+    switch(order) {
+        case CONTIGUOUS_POSITIONS:
+            if(num_positions > 0) {
+                memcpy(values, &data[positions[0]], sizeof(int) * num_positions);
+            }
+            break;
+        case SORTED_POSITIONS:
+            // the hardware prefetcher follows sorted positions on its own
+            for(; i < num_positions; i++) {
+                values[i] = data[positions[i]];
+            }
+            break;
+        case RANDOM_POSITIONS:
+            for(; i + FETCH_PREFETCH_DISTANCE < num_positions; i++) {
+                __builtin_prefetch(&data[positions[i + FETCH_PREFETCH_DISTANCE]]);
+                values[i] = data[positions[i]];
+            }
+            for(; i < num_positions; i++) {
+                values[i] = data[positions[i]];
+            }
+            break;
+    }
 }
 
 void execute_fetch(DbOperator* query) {
     ClientContext* context = query->context;
-    Column* val_vec = query->operator_fields.fetch_operator.col1->column_pointer.column;
-    Result* pos_vec = query->operator_fields.fetch_operator.col2->column_pointer.result; 
-    char* handle = query->operator_fields.fetch_operator.handle;
-
-    Result* result = (Result*) malloc(sizeof(Result));
-    result->num_tuples = pos_vec->num_tuples;
-    result->payload = malloc(sizeof(int) * result->num_tuples);
-    result->data_type = INT;
-    for(size_t i = 0; i < pos_vec->num_tuples; i++) {
-        ((int*)result->payload)[i] = val_vec->data[((int*)pos_vec->payload)[i]];
+    FetchOperator* fetch = &query->operator_fields.fetch_operator;
+    Result* pos_vec = fetch->pos_vec->column_pointer.result; 
+    int* positions = pos_vec->payload;
+    size_t num_positions = pos_vec->num_tuples;
+
+    // every column is cached on its own, like a fetch of just that column
+    Fingerprint fingerprints[fetch->num_cols];
+    Result* results[fetch->num_cols];
+    int* data[fetch->num_cols];
+    size_t fetched_cols[fetch->num_cols];
+    size_t num_fetched = 0;
+    for(size_t i = 0; i < fetch->num_cols; i++) {
+        init_fingerprint(&fingerprints[num_fetched], FETCH, 0, fetch->cols[i], fetch->pos_vec);
+        if(reuse_cached_result(context, &fingerprints[num_fetched], fetch->handles[i])) {
+            continue;
+        }
+        fetched_cols[num_fetched] = i;
+        data[num_fetched] = fetch->cols[i]->column_pointer.column->data;
+        results[num_fetched] = init_result();
+        results[num_fetched]->num_tuples = num_positions;
+        results[num_fetched]->payload = malloc(sizeof(int) * num_positions);
+        num_fetched++;
+    }
+    if(num_fetched == 0) {
+        return;
+    }
+
+    // the positions are read once per block for all the columns, one column has nothing to share
+    PositionOrder order = get_position_order(positions, num_positions);
+    size_t block_size = num_fetched == 1 ? num_positions : FETCH_BLOCK_SIZE;
+    for(size_t block = 0; block < num_positions; block += block_size) {
+        size_t cur_block_size = num_positions - block < block_size ? num_positions - block : block_size;
+        for(size_t i = 0; i < num_fetched; i++) {
+            fetch_values_in_order(data[i], &positions[block], cur_block_size, 
+                                  (int*)results[i]->payload + block, order);
+        }
+    }
+
+    // positions in order read a sorted column in order
+    for(size_t i = 0; i < num_fetched; i++) {
+        results[i]->sorted = order != RANDOM_POSITIONS && fetch->cols[fetched_cols[i]]->column_pointer.column->sorted;
+        cache_and_add_result(context, &fingerprints[i], fetch->handles[fetched_cols[i]], results[i]);
     }
+}
+
+void* get_aggregate_input(GeneralizedColumn* col, size_t* data_length, bool* is_long) {
+    if(col->column_type == COLUMN) {
+        Column* column = col->column_pointer.column;
+        *data_length = column->table->table_length;
+        *is_long = false;
+        return column->data;
+    }
+    Result* result = col->column_pointer.result;
+    *data_length = result->num_tuples;
+    *is_long = result->data_type == LONG;
+    return result->payload;
+}
+
+typedef struct ThreadAggregate {
+    int* data;
+    size_t data_length;
+    AggregateStats stats;
+} ThreadAggregate;
+
+void* thread_aggregate(void* args) {
+    ThreadAggregate* cast_arg = (ThreadAggregate*) args;
+    aggregate_values(cast_arg->data, cast_arg->data_length, &cast_arg->stats);
+    return (void*)args;
+}
+
+// every chunk of the vector gets its own partial stats, merged once all chunks are done.
+// The sums are exact longs, so the order of the merge does not matter.
+void aggregate_in_parallel(int* data, size_t data_length, AggregateStats* stats) {
+    size_t num_chunks = (data_length + PARALLEL_AGGREGATE_CHUNK_SIZE - 1) / PARALLEL_AGGREGATE_CHUNK_SIZE;
+    size_t num_threads = get_num_cores();
+    if(num_chunks < 2 || num_threads < 2) {
+        aggregate_values(data, data_length, stats);
+        return;
+    }
+
+    ThreadAggregate* chunks = malloc(sizeof(ThreadAggregate) * num_chunks);
+    for(size_t i = 0; i < num_chunks; i++) {
+        size_t first = i * PARALLEL_AGGREGATE_CHUNK_SIZE;
+        chunks[i].data = data + first;
+        chunks[i].data_length = data_length - first < PARALLEL_AGGREGATE_CHUNK_SIZE ? data_length - first : PARALLEL_AGGREGATE_CHUNK_SIZE;
+        chunks[i].stats = *stats;
+        chunks[i].stats.sum = 0;
+        chunks[i].stats.count = 0;
+    }
+    run_tasks_in_parallel(thread_aggregate, chunks, sizeof(ThreadAggregate), num_chunks, num_threads);
+
+    for(size_t i = 0; i < num_chunks; i++) {
+        stats->sum += chunks[i].stats.sum;
+        stats->count += chunks[i].stats.count;
+        stats->min = chunks[i].stats.min < stats->min ? chunks[i].stats.min : stats->min;
+        stats->max = chunks[i].stats.max > stats->max ? chunks[i].stats.max : stats->max;
+    }
+    free(chunks);
+}
 
-    add_result_to_context(context, handle, result); 
+// min, max, sum and avg of the same vector share one pass, its stats are cached for the others
+void get_aggregate_stats(ClientContext* context, GeneralizedColumn* col, int* data, size_t data_length, AggregateStats* stats) {
+    Fingerprint fingerprint;
+    init_fingerprint(&fingerprint, AGGREGATE, STATS, col, NULL);
+    Result* cached = lookup_cached_result(context, &fingerprint);
+    if(cached != NULL) {
+        memcpy(stats, cached->payload, sizeof(AggregateStats));
+        free_result(cached);
+        return;
+    }
+
+    AggregateStats vector_stats = {0, INT_MAX, INT_MIN, 0};
+    aggregate_in_parallel(data, data_length, &vector_stats);
+    *stats = vector_stats;
+
+    Result* result = init_result();
+    result->num_tuples = 1;
+    result->payload_bytes = sizeof(AggregateStats);
+    result->payload = malloc(sizeof(AggregateStats));
+    memcpy(result->payload, &vector_stats, sizeof(AggregateStats));
+    cache_result(context, &fingerprint, result);
+    free_result(result);
 }
 
 void execute_sum_avg(DbOperator* query, bool sum) {
@@ -1247,43 +1856,40 @@ void execute_sum_avg(DbOperator* query, bool sum) {
     GeneralizedColumn* col = query->operator_fields.aggregate_operator.col1;
     char* handle = query->operator_fields.aggregate_operator.handle;
 
-    int* data = NULL;
+    Fingerprint fingerprint;
+    init_fingerprint(&fingerprint, AGGREGATE, query->operator_fields.aggregate_operator.type, col, NULL);
+    if(reuse_cached_result(context, &fingerprint, handle)) {
+        return;
+    }
+
     size_t data_length = 0;
+    bool is_long = false;
+    void* data = get_aggregate_input(col, &data_length, &is_long);
 
-    if(col->column_type == COLUMN) {
-        Column* vec = col->column_pointer.column;
-        data = vec->data;
-        data_length = vec->table->table_length;
+    long col_sum = 0;
+    if(is_long) {
+        col_sum = sum_long_values(data, data_length);
     }
     else {
-        Result* vec = col->column_pointer.result; 
-        data = vec->payload; 
-        data_length = vec->num_tuples;
+        AggregateStats stats;
+        get_aggregate_stats(context, col, data, data_length, &stats);
+        col_sum = stats.sum;
     }
 
-    Result* result = (Result*) malloc(sizeof(Result));
+    Result* result = init_result();
+    result->num_tuples = 1;
     if(sum) {
         result->payload = malloc(sizeof(long)); 
-        result->num_tuples = 1;
         result->data_type = LONG;
-        long col_sum = 0; 
-        for(size_t i = 0; i < data_length; i++) {
-            col_sum += data[i];
-        }
         ((long*)result->payload)[0] = col_sum; 
     }
     else {
         result->payload = malloc(sizeof(double)); 
-        result->num_tuples = 1;
         result->data_type = DOUBLE;
-        double col_sum = 0; 
-        for(size_t i = 0; i < data_length; i++) {
-            col_sum += data[i];
-        }
-        ((double*)result->payload)[0] = col_sum / data_length; 
+        ((double*)result->payload)[0] = (double)col_sum / data_length; 
     }
 
-    add_result_to_context(context, handle, result); 
+    cache_and_add_result(context, &fingerprint, handle, result); 
 }
 
 void execute_sub_add(DbOperator* query, bool sub) {
@@ -1292,49 +1898,79 @@ void execute_sub_add(DbOperator* query, bool sub) {
     GeneralizedColumn* col2 = query->operator_fields.aggregate_operator.col2; 
     char* handle = query->operator_fields.aggregate_operator.handle;
 
-    int* data1 = NULL;
-    int* data2 = NULL; 
-    size_t data_length = 0;
+    Fingerprint fingerprint;
+    init_fingerprint(&fingerprint, AGGREGATE, query->operator_fields.aggregate_operator.type, col1, col2);
+    if(reuse_cached_result(context, &fingerprint, handle)) {
+        return;
+    }
 
+    size_t data_length = 0;
+    size_t data2_length = 0;
+    bool long1 = false;
+    bool long2 = false;
+    void* data1 = get_aggregate_input(col1, &data_length, &long1);
+    void* data2 = get_aggregate_input(col2, &data2_length, &long2);
 
-    if(col1->column_type == COLUMN) {
-        Column* vec1 = col1->column_pointer.column;
-        data1 = vec1->data;
-        data_length = vec1->table->table_length;
-    }
-    else {
-        Result* vec1 = col1->column_pointer.result; 
-        data1 = vec1->payload; 
-        data_length = vec1->num_tuples;
-    }
+    Result* result = init_result();
+    result->num_tuples = data_length;
 
-    if(col2->column_type == COLUMN) {
-        Column* vec2 = col2->column_pointer.column;
-        data2 = vec2->data;
+    // the values stay ints unless one of them does not fit, then the vector is redone in longs
+    bool fits = false;
+    if(!long1 && !long2) {
+        result->payload = malloc(sizeof(int) * data_length); 
+        if(sub) {
+            fits = sub_values(data1, data2, data_length, result->payload);
+        }
+        else {
+            fits = add_values(data1, data2, data_length, result->payload);
+        }
+        if(!fits) {
+            free(result->payload);
+        }
     }
-    else {
-        Result* vec2 = col2->column_pointer.result; 
-        data2 = vec2->payload; 
+    if(!fits) {
+        result->payload = malloc(sizeof(long) * data_length); 
+        result->data_type = LONG;
+        if(sub) {
+            sub_long_values(data1, long1, data2, long2, data_length, result->payload);
+        }
+        else {
+            add_long_values(data1, long1, data2, long2, data_length, result->payload);
+        }
     }
 
-    Result* result = (Result*) malloc(sizeof(Result));
-    // TODO: maybe change to LONG?
-    result->payload = malloc(sizeof(int) * data_length); 
-    result->num_tuples = data_length;
-    result->data_type = INT;
+    cache_and_add_result(context, &fingerprint, handle, result); 
+}
 
-    if(sub) {
-        for(size_t i = 0; i < data_length; i++) {
-            ((int*)result->payload)[i] = data1[i] - data2[i];
+// min or max of the values at the positions, gathered one cache sized block at a time
+int min_max_fetched_values(int* values, int* positions, size_t num_positions, bool min) {
+    int block[FETCH_BLOCK_SIZE];
+    int result = min ? INT_MAX : INT_MIN;
+    for(size_t i = 0; i < num_positions; i += FETCH_BLOCK_SIZE) {
+        size_t block_size = num_positions - i < FETCH_BLOCK_SIZE ? num_positions - i : FETCH_BLOCK_SIZE;
+        fetch_values(values, positions + i, block_size, block);
+        if(min) {
+            int block_min = min_values(block, block_size);
+            result = block_min < result ? block_min : result;
         }
-    }
-    else {
-        for(size_t i = 0; i < data_length; i++) {
-            ((int*)result->payload)[i] = data1[i] + data2[i];
+        else {
+            int block_max = max_values(block, block_size);
+            result = block_max > result ? block_max : result;
         }
     }
+    return result;
+}
 
-    add_result_to_context(context, handle, result); 
+// min or max of the long values (sums of add or sub) at the positions
+long min_max_fetched_long_values(long* values, int* positions, size_t num_positions, bool min) {
+    long result = min ? LONG_MAX : LONG_MIN;
+    for(size_t i = 0; i < num_positions; i++) {
+        long value = values[positions[i]];
+        if(min ? value < result : value > result) {
+            result = value;
+        }
+    }
+    return result;
 }
 
 void execute_min_max(DbOperator* query, bool min) {
@@ -1343,82 +1979,114 @@ void execute_min_max(DbOperator* query, bool min) {
     GeneralizedColumn* col2 = query->operator_fields.aggregate_operator.col2; 
     char* handle = query->operator_fields.aggregate_operator.handle;
 
-    int* data1 = NULL;
-    size_t data1_length = 0;
-    int* data2 = NULL; 
-    int result; 
-    if(min) {
-        result = INT_MAX;
+    Fingerprint fingerprint;
+    init_fingerprint(&fingerprint, AGGREGATE, query->operator_fields.aggregate_operator.type, col1, col2);
+    if(reuse_cached_result(context, &fingerprint, handle)) {
+        return;
     }
-    else {
-        result = INT_MIN;
+
+    size_t data1_length = 0;
+    bool is_long = false;
+    void* data1 = get_aggregate_input(col1, &data1_length, &is_long);
+    int index_value;
+
+    Result* result_vec = init_result();
+    result_vec->num_tuples = 1;
+    if(col2 == NULL && col1->column_type == COLUMN && col1->column_pointer.column->index != NULL &&
+       index_min_max(col1->column_pointer.column->index, data1_length, min, &index_value)) {
+        result_vec->payload = malloc(sizeof(int));
+        ((int*)result_vec->payload)[0] = index_value;
     }
+    else if(col2 != NULL) {
+        size_t data2_length = 0;
+        bool long2 = false;
+        void* data2 = get_aggregate_input(col2, &data2_length, &long2);
 
-    if(col2 != NULL) {
-        Result* vec1 = col1->column_pointer.result; 
-        data1 = vec1->payload; 
-        data1_length = vec1->num_tuples;
-        
-        if(col2->column_type == COLUMN) {
-            Column* vec2 = col2->column_pointer.column;
-            data2 = vec2->data;
-        }
-        else {
-            Result* vec2 = col2->column_pointer.result; 
-            data2 = vec2->payload; 
-        }
-        if(min) {
-            for(size_t i = 0; i < data1_length; i++) {
-                if(data2[data1[i]] < result) {
-                    result = data2[data1[i]];
-                }
-            }
+        if(long2) {
+            result_vec->payload = malloc(sizeof(long));
+            result_vec->data_type = LONG;
+            ((long*)result_vec->payload)[0] = min_max_fetched_long_values(data2, data1, data1_length, min);
         }
         else {
-            for(size_t i = 0; i < data1_length; i++) {
-                if(data2[data1[i]] > result) {
-                    result = data2[data1[i]];
-                }
-            }
+            result_vec->payload = malloc(sizeof(int));
+            ((int*)result_vec->payload)[0] = min_max_fetched_values(data2, data1, data1_length, min);
         }
-    
+    }
+    else if(is_long) {
+        result_vec->payload = malloc(sizeof(long));
+        result_vec->data_type = LONG;
+        ((long*)result_vec->payload)[0] = min ? min_long_values(data1, data1_length) : max_long_values(data1, data1_length);
     }
     else {
-        if(col1->column_type == COLUMN) {
-            Column* vec1 = col1->column_pointer.column;
-            data1 = vec1->data;
-            data1_length = vec1->table->table_length;
-        }
-        else {
-            Result* vec1 = col1->column_pointer.result; 
-            data1 = vec1->payload; 
-            data1_length = vec1->num_tuples;
-        }
-        if(min) {
-            for(size_t i = 0; i < data1_length; i++) {
-                if(data1[i] < result) {
-                    result = data1[i];
-                }
-            }
-        }
-        else {
-            for(size_t i = 0; i < data1_length; i++) {
-                if(data1[i] > result) {
-                    result = data1[i];
-                }
-            }
-        }
+        AggregateStats stats;
+        get_aggregate_stats(context, col1, data1, data1_length, &stats);
+        result_vec->payload = malloc(sizeof(int));
+        ((int*)result_vec->payload)[0] = min ? stats.min : stats.max;
     }
 
-    // place in handle
-    Result* result_vec = (Result*) malloc(sizeof(Result));
-    result_vec->num_tuples = 1;
-    result_vec->payload = malloc(sizeof(int));
-    result_vec->data_type = INT;
-    ((int*)result_vec->payload)[0] = result;
+    cache_and_add_result(context, &fingerprint, handle, result_vec); 
+}
+
+// the count of a vector is its length, counts of selects run as pipelines
+void execute_count(DbOperator* query) {
+    size_t data_length = 0;
+    bool is_long = false;
+    get_aggregate_input(query->operator_fields.aggregate_operator.col1, &data_length, &is_long);
+
+    Result* result = init_result();
+    result->num_tuples = 1;
+    result->data_type = LONG;
+    result->payload = malloc(sizeof(long));
+    ((long*)result->payload)[0] = data_length;
+    add_result_to_context(query->context, query->operator_fields.aggregate_operator.handle, result);
+}
 
-    add_result_to_context(context, handle, result_vec); 
+// the exact count is cached like the other aggregates, the estimate of a column comes from its sketch
+void execute_count_distinct(DbOperator* query, bool approximate) {
+    ClientContext* context = query->context;
+    GeneralizedColumn* col = query->operator_fields.aggregate_operator.col1;
+    char* handle = query->operator_fields.aggregate_operator.handle;
+
+    Fingerprint fingerprint;
+    init_fingerprint(&fingerprint, AGGREGATE, query->operator_fields.aggregate_operator.type, col, NULL);
+    if(!approximate && reuse_cached_result(context, &fingerprint, handle)) {
+        return;
+    }
 
+    size_t data_length = 0;
+    bool is_long = false;
+    int* data = get_aggregate_input(col, &data_length, &is_long);
+
+    long num_distinct = 0;
+    if(!approximate) {
+        num_distinct = count_distinct_values(data, data_length);
+    }
+    else if(col->column_type == COLUMN) {
+        Column* column = col->column_pointer.column;
+        if(column->sketch == NULL) {
+            column->sketch = create_hyperloglog();
+            hyperloglog_add_values(column->sketch, data, data_length);
+        }
+        num_distinct = lround(hyperloglog_estimate(column->sketch));
+    }
+    else {
+        HyperLogLog* sketch = create_hyperloglog();
+        hyperloglog_add_values(sketch, data, data_length);
+        num_distinct = lround(hyperloglog_estimate(sketch));
+        free(sketch);
+    }
+
+    Result* result = init_result();
+    result->num_tuples = 1;
+    result->data_type = LONG;
+    result->payload = malloc(sizeof(long));
+    ((long*)result->payload)[0] = num_distinct;
+    if(approximate) {
+        add_result_to_context(context, handle, result);
+    }
+    else {
+        cache_and_add_result(context, &fingerprint, handle, result); 
+    }
 }
 
 void execute_aggregate(DbOperator* query) {
@@ -1442,5 +2110,134 @@ void execute_aggregate(DbOperator* query) {
         case ADD:
             execute_sub_add(query, false); 
             break; 
+        case COUNT:
+            execute_count(query); 
+            break; 
+        case COUNT_DISTINCT:
+            execute_count_distinct(query, false); 
+            break; 
+        case APPROX_COUNT_DISTINCT:
+            execute_count_distinct(query, true); 
+            break; 
+        case STATS:
+            break;
     }
 }
+
+// folds the values at the positions into the aggregate, only the requested aggregate is computed
+void aggregate_fetched_values(int* values, int* positions, size_t num_positions, AggregateType type, AggregateStats* aggregate) {
+    switch(type) {
+        case MIN:
+        {
+            int min = min_max_fetched_values(values, positions, num_positions, true);
+            aggregate->min = min < aggregate->min ? min : aggregate->min;
+            break;
+        }
+        case MAX:
+        {
+            int max = min_max_fetched_values(values, positions, num_positions, false);
+            aggregate->max = max > aggregate->max ? max : aggregate->max;
+            break;
+        }
+        case COUNT:
+            break;
+        default:
+        {
+            int block[FETCH_BLOCK_SIZE];
+            for(size_t i = 0; i < num_positions; i += FETCH_BLOCK_SIZE) {
+                size_t block_size = num_positions - i < FETCH_BLOCK_SIZE ? num_positions - i : FETCH_BLOCK_SIZE;
+                fetch_values(values, positions + i, block_size, block);
+                aggregate->sum += sum_values(block, block_size);
+            }
+            break;
+        }
+    }
+    aggregate->count += num_positions;
+}
+
+void execute_pipeline(DbOperator* query) {
+    ClientContext* context = query->context;
+    PipelineOperator* pipeline = &query->operator_fields.pipeline_operator;
+    Comparator* comparator = pipeline->comparator;
+    char* handle = pipeline->handle;
+
+    Fingerprint fingerprint;
+    init_fingerprint(&fingerprint, PIPELINE, pipeline->type, comparator->gen_col, comparator->vec_pos);
+    fingerprint_input(&fingerprint, 2, pipeline->fetch_col);
+    fingerprint_comparator(&fingerprint, comparator);
+    if(reuse_cached_result(context, &fingerprint, handle)) {
+        return;
+    }
+
+    int* values = NULL;
+    if(pipeline->fetch_col != NULL) {
+        values = pipeline->fetch_col->column_pointer.column->data;
+    }
+    AggregateStats aggregate = {0, INT_MAX, INT_MIN, 0};
+
+    GeneralizedColumn* col_vec = comparator->gen_col;
+    bool indexed = comparator->vec_pos == NULL && col_vec->column_type == COLUMN && col_vec->column_pointer.column->index != NULL;
+    Column* fetch_column = pipeline->fetch_col != NULL ? pipeline->fetch_col->column_pointer.column : NULL;
+    if(indexed && col_vec->column_pointer.column->clustered && col_vec->column_pointer.column->index->type == SORTED &&
+       (pipeline->type == SUM || pipeline->type == AVG) && fetch_column->prefix_sum != NULL) {
+        // the table is sorted by the clustered column, so the select qualifies one range of positions
+        Column* column = col_vec->column_pointer.column;
+        size_t first;
+        size_t last;
+        find_sorted_index_range(&column->index->index_fields.sorted_index, comparator, column->table->table_length, &first, &last);
+        aggregate.sum = prefix_range_sum(fetch_column, first, last);
+        aggregate.count = last - first;
+    }
+    else if(indexed && (values == NULL || values == col_vec->column_pointer.column->data)) {
+        // the values are the indexed ones, the index holds them in order
+        Column* column = col_vec->column_pointer.column;
+        aggregate_index_range(column->index, comparator, column->table->table_length, pipeline->type, &aggregate);
+    }
+    else if(indexed) {
+        // the index hands out the positions in index order, there is no scan to chunk
+        Column* column = col_vec->column_pointer.column;
+        Result* positions = init_result();
+        positions->payload = malloc(sizeof(int) * column->table->table_length);
+        select_from_index(column->index, comparator, positions, column->table->table_length);
+        aggregate_fetched_values(values, positions->payload, positions->num_tuples, pipeline->type, &aggregate);
+        free_result(positions);
+    }
+    else {
+        // the positions of one vector stay in a cache sized buffer between the select and the fetch
+        int vector_positions[SELECT_VECTOR_SIZE];
+        Result positions;
+        positions.payload = vector_positions;
+        size_t data_length = get_comparator_data_length(comparator);
+        for(size_t cur_loc = 0; cur_loc < data_length; cur_loc += SELECT_VECTOR_SIZE) {
+            select_vector(comparator, cur_loc, &positions);
+            aggregate_fetched_values(values, vector_positions, positions.num_tuples, pipeline->type, &aggregate);
+        }
+    }
+
+    Result* result = init_result();
+    result->num_tuples = 1;
+    switch(pipeline->type) {
+        case MIN:
+        case MAX:
+            result->payload = malloc(sizeof(int));
+            ((int*)result->payload)[0] = pipeline->type == MIN ? aggregate.min : aggregate.max;
+            break;
+        case AVG:
+            result->payload = malloc(sizeof(double));
+            result->data_type = DOUBLE;
+            ((double*)result->payload)[0] = (double)aggregate.sum / aggregate.count;
+            break;
+        case COUNT:
+            result->payload = malloc(sizeof(long));
+            result->data_type = LONG;
+            ((long*)result->payload)[0] = aggregate.count;
+            break;
+        default:
+            result->payload = malloc(sizeof(long));
+            result->data_type = LONG;
+            ((long*)result->payload)[0] = aggregate.sum;
+            break;
+    }
+
+    cache_and_add_result(context, &fingerprint, handle, result);
+}
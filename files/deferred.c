@@ -0,0 +1,550 @@
+#define _DEFAULT_SOURCE
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#include "include/deferred.h"
+#include "include/parse.h"
+#include "include/client_context.h"
+#include "include/utils.h"
+
+// the operators whose only effect is writing their handle, they can run whenever it is needed
+char* deferrable_operators[] = {"select(", "fetch(", "min(", "max(", "sum(", "avg(", "add(", "sub(", "count("};
+// the aggregates that can be fused with the fetch and select they read from
+char* pipeline_operators[] = {"min(", "max(", "sum(", "avg("};
+
+bool starts_with_any(char* query, char** prefixes, size_t num_prefixes) {
+    for(size_t i = 0; i < num_prefixes; i++) {
+        if(strncmp(query, prefixes[i], strlen(prefixes[i])) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// returns the right hand side of the query, the part after the handle
+char* deferred_operation(DeferredQuery* deferred) {
+    return deferred->query + strlen(deferred->handle) + 1;
+}
+
+// returns the index of the deferred query writing the handle, or -1 if no deferred query does
+int find_deferred_writer(ClientContext* context, char* handle) {
+    for(int i = 0; i < context->deferred_in_use; i++) {
+        if(strcmp(context->deferred_queries[i].handle, handle) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool reads_handle(DeferredQuery* deferred, char* handle) {
+    for(size_t i = 0; i < deferred->num_inputs; i++) {
+        if(strcmp(deferred->inputs[i], handle) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// collects the handles among the arguments of an operation: the identifiers that are not a column
+// (db.tbl.col), null, a number or the name of a nested operator. Returns false if there are too many.
+bool find_deferred_inputs(char* operation, DeferredQuery* deferred) {
+    deferred->num_inputs = 0;
+    char* cur = operation;
+    while(*cur != '\0') {
+        size_t length = strcspn(cur, "(),");
+        char delimiter = cur[length];
+        if(length > 0 && delimiter != '(' && isalpha(cur[0]) && memchr(cur, '.', length) == NULL &&
+           !(length == 4 && strncmp(cur, "null", 4) == 0)) {
+            if(deferred->num_inputs == MAX_DEFERRED_QUERY_INPUTS || length >= HANDLE_MAX_SIZE) {
+                return false;
+            }
+            strncpy(deferred->inputs[deferred->num_inputs], cur, length);
+            deferred->inputs[deferred->num_inputs++][length] = '\0';
+        }
+        cur += length;
+        if(delimiter != '\0') {
+            cur++;
+        }
+    }
+    return true;
+}
+
+// whether every column (db.tbl.col) among the arguments of an operation exists
+bool deferred_columns_exist(char* operation) {
+    char* cur = operation;
+    while(*cur != '\0') {
+        size_t length = strcspn(cur, "(),");
+        if(length > 0 && cur[length] != '(' && memchr(cur, '.', length) != NULL) {
+            // the lookup splits the name in place
+            char column_name[length + 1];
+            strncpy(column_name, cur, length);
+            column_name[length] = '\0';
+            if(lookup_column(column_name) == NULL) {
+                return false;
+            }
+        }
+        cur += length;
+        if(*cur != '\0') {
+            cur++;
+        }
+    }
+    return true;
+}
+
+void remove_deferred_query(ClientContext* context, int index) {
+    free(context->deferred_queries[index].query);
+    for(int i = index + 1; i < context->deferred_in_use; i++) {
+        context->deferred_queries[i - 1] = context->deferred_queries[i];
+    }
+    context->deferred_in_use--;
+}
+
+// returns the fetch an aggregate query can be fused with, or -1. The aggregate has to read a
+// deferred fetch of a deferred select, and no deferred query after the select may write the
+// handles the select reads, since the fused query reads them when the aggregate runs.
+int find_fusable_fetch(ClientContext* context, int index) {
+    DeferredQuery* queries = context->deferred_queries;
+    // the aggregate has to be exactly op(handle)
+    char* operation = deferred_operation(&queries[index]);
+    if(!starts_with_any(operation, pipeline_operators, sizeof(pipeline_operators) / sizeof(char*)) ||
+       queries[index].num_inputs != 1 || strlen(operation) != strlen(queries[index].inputs[0]) + 5) {
+        return -1;
+    }
+    int fetch = find_deferred_writer(context, queries[index].inputs[0]);
+    if(fetch == -1 || fetch > index || strncmp(deferred_operation(&queries[fetch]), "fetch(", 6) != 0 ||
+       queries[fetch].num_inputs != 1) {
+        return -1;
+    }
+    int select = find_deferred_writer(context, queries[fetch].inputs[0]);
+    if(select == -1 || select > fetch || strncmp(deferred_operation(&queries[select]), "select(", 7) != 0) {
+        return -1;
+    }
+    for(size_t i = 0; i < queries[select].num_inputs; i++) {
+        if(find_deferred_writer(context, queries[select].inputs[i]) > select) {
+            return -1;
+        }
+    }
+    return fetch;
+}
+
+// marks the query and everything it depends on as needed. A query depends on the deferred queries
+// writing its inputs, and on the earlier deferred queries reading the handle it overwrites.
+void need_deferred_query(ClientContext* context, int index, bool* needed, int* fused) {
+    if(needed[index]) {
+        return;
+    }
+    needed[index] = true;
+
+    DeferredQuery* queries = context->deferred_queries;
+    int reader = index;
+    int fetch = find_fusable_fetch(context, index);
+    if(fetch != -1) {
+        // the fused query reads the inputs of the select in place of the fetch result
+        fused[index] = fetch;
+        reader = find_deferred_writer(context, queries[fetch].inputs[0]);
+    }
+    for(size_t i = 0; i < queries[reader].num_inputs; i++) {
+        int writer = find_deferred_writer(context, queries[reader].inputs[i]);
+        if(writer != -1 && writer < reader) {
+            need_deferred_query(context, writer, needed, fused);
+        }
+    }
+    for(int i = 0; i < index; i++) {
+        if(reads_handle(&queries[i], queries[index].handle)) {
+            need_deferred_query(context, i, needed, fused);
+        }
+    }
+}
+
+// the client was told the query succeeded when it was deferred, an error is kept for the next reply
+void execute_deferred_query(ClientContext* context, char* query_command) {
+    message send_message;
+    send_message.payload = NULL;
+    DbOperator* query = parse_command(query_command, &send_message, context, NULL);
+    if(query == NULL && send_message.status != OK_WAIT_FOR_RESPONSE && send_message.status != OK_DONE &&
+       context->deferred_status == OK_DONE) {
+        cs165_log(stdout, "Deferred query %s failed\n", query_command);
+        context->deferred_status = send_message.status;
+    }
+    execute_db_operator(query);
+}
+
+// rewrites a=sum(f), f=fetch(col,s), s=select(args) into a=sum(fetch(col,select(args)))
+void execute_fused_query(ClientContext* context, DeferredQuery* aggregate, DeferredQuery* fetch) {
+    DeferredQuery* select = &context->deferred_queries[find_deferred_writer(context, fetch->inputs[0])];
+    char* aggregate_operation = deferred_operation(aggregate);
+    char* fetch_operation = deferred_operation(fetch);
+    char* select_operation = deferred_operation(select);
+
+    size_t length = strlen(aggregate->query) + strlen(fetch->query) + strlen(select->query) + 1;
+    char query_command[length];
+    int column_length = strcspn(fetch_operation, ",") - 6;
+    snprintf(query_command, length, "%s=%.3s(fetch(%.*s,%s))", aggregate->handle, aggregate_operation,
+             column_length, fetch_operation + 6, select_operation);
+    cs165_log(stdout, "Fused deferred queries into %s\n", query_command);
+    execute_deferred_query(context, query_command);
+}
+
+bool is_plain_fetch(DeferredQuery* deferred) {
+    return strncmp(deferred_operation(deferred), "fetch(", 6) == 0 && deferred->num_inputs == 1;
+}
+
+// whether the query reads the handle when it runs, a fused aggregate reads the inputs of its select
+bool reads_handle_when_run(ClientContext* context, int index, int* fused, char* handle) {
+    DeferredQuery* queries = context->deferred_queries;
+    if(fused[index] != -1) {
+        int select = find_deferred_writer(context, queries[fused[index]].inputs[0]);
+        return reads_handle(&queries[select], handle);
+    }
+    return reads_handle(&queries[index], handle);
+}
+
+// runs the fetch together with the later needed fetches of the same positions, as in
+// a,b=fetch(col_a,col_b,pos). A later fetch can move up as long as no query in between
+// overwrites the positions or reads the handle the fetch writes.
+void execute_merged_fetches(ClientContext* context, int index, bool* needed, int* fused, bool* executed) {
+    DeferredQuery* queries = context->deferred_queries;
+    char* positions = queries[index].inputs[0];
+    int merged[context->deferred_in_use];
+    int num_merged = 0;
+    size_t length = strlen(queries[index].query);
+    merged[num_merged++] = index;
+
+    for(int j = index + 1; j < context->deferred_in_use; j++) {
+        if(!needed[j] || executed[j]) {
+            continue;
+        }
+        if(strcmp(queries[j].handle, positions) == 0) {
+            break;
+        }
+        if(fused[j] != -1 || !is_plain_fetch(&queries[j]) || strcmp(queries[j].inputs[0], positions) != 0) {
+            continue;
+        }
+        bool movable = true;
+        for(int k = index + 1; k < j && movable; k++) {
+            if(needed[k] && !executed[k] && reads_handle_when_run(context, k, fused, queries[j].handle)) {
+                movable = false;
+            }
+        }
+        if(movable) {
+            merged[num_merged++] = j;
+            executed[j] = true;
+            length += strlen(queries[j].query);
+        }
+    }
+
+    // handles and columns in the order of the fetches, then the positions
+    char query_command[length + 1];
+    char* cur = query_command;
+    for(int i = 0; i < num_merged; i++) {
+        cur += sprintf(cur, i == 0 ? "%s" : ",%s", queries[merged[i]].handle);
+    }
+    cur += sprintf(cur, "=fetch(");
+    for(int i = 0; i < num_merged; i++) {
+        char* column = deferred_operation(&queries[merged[i]]) + 6;
+        cur += sprintf(cur, "%.*s,", (int)strcspn(column, ","), column);
+    }
+    sprintf(cur, "%s)", positions);
+    if(num_merged > 1) {
+        cs165_log(stdout, "Merged deferred fetches into %s\n", query_command);
+    }
+    execute_deferred_query(context, query_command);
+}
+
+// runs the deferred queries the handles need, in the order the client sent them. With handles
+// NULL every deferred query runs.
+void flush_deferred_queries(ClientContext* context, char** handles, size_t num_handles) {
+    int num_deferred = context->deferred_in_use;
+    if(num_deferred == 0) {
+        return;
+    }
+    bool needed[num_deferred];
+    int fused[num_deferred];
+    for(int i = 0; i < num_deferred; i++) {
+        needed[i] = false;
+        fused[i] = -1;
+    }
+
+    if(handles == NULL) {
+        for(int i = 0; i < num_deferred; i++) {
+            needed[i] = true;
+        }
+    }
+    else {
+        for(size_t i = 0; i < num_handles; i++) {
+            int writer = find_deferred_writer(context, handles[i]);
+            if(writer != -1) {
+                need_deferred_query(context, writer, needed, fused);
+            }
+        }
+        // a fetch several aggregates read is cheaper to run once than to fuse into each of them
+        for(int i = 0; i < num_deferred; i++) {
+            for(int j = i + 1; j < num_deferred && fused[i] != -1; j++) {
+                if(fused[j] == fused[i]) {
+                    need_deferred_query(context, fused[i], needed, fused);
+                }
+            }
+        }
+        // fusing only pays off while the fetch (and so the select) does not run anyway
+        for(int i = 0; i < num_deferred; i++) {
+            if(fused[i] != -1 && needed[fused[i]]) {
+                fused[i] = -1;
+            }
+        }
+    }
+
+    bool executed[num_deferred];
+    for(int i = 0; i < num_deferred; i++) {
+        executed[i] = false;
+    }
+    for(int i = 0; i < num_deferred; i++) {
+        if(!needed[i] || executed[i]) {
+            continue;
+        }
+        executed[i] = true;
+        if(fused[i] != -1) {
+            execute_fused_query(context, &context->deferred_queries[i], &context->deferred_queries[fused[i]]);
+        }
+        else if(is_plain_fetch(&context->deferred_queries[i])) {
+            execute_merged_fetches(context, i, needed, fused, executed);
+        }
+        else {
+            // parsing splits the query in place, the select of a later fused query may still need it
+            char query_command[strlen(context->deferred_queries[i].query) + 1];
+            strcpy(query_command, context->deferred_queries[i].query);
+            execute_deferred_query(context, query_command);
+        }
+    }
+
+    int kept = 0;
+    for(int i = 0; i < num_deferred; i++) {
+        if(needed[i]) {
+            free(context->deferred_queries[i].query);
+        }
+        else {
+            context->deferred_queries[kept++] = context->deferred_queries[i];
+        }
+    }
+    context->deferred_in_use = kept;
+}
+
+// records the query instead of executing it, returns false if the query has to run right away
+bool defer_query(ClientContext* context, char* query_command) {
+    char* equals_pointer = strchr(query_command, '=');
+    if(equals_pointer == NULL || strncmp(query_command, "--", 2) == 0) {
+        return false;
+    }
+
+    DeferredQuery deferred;
+    deferred.query = malloc(strlen(query_command) + 1);
+    strcpy(deferred.query, query_command);
+    trim_whitespace(deferred.query);
+    size_t handle_length = strcspn(deferred.query, "=");
+    char* operation = deferred.query + handle_length + 1;
+    if(handle_length == 0 || handle_length >= HANDLE_MAX_SIZE || memchr(deferred.query, ',', handle_length) != NULL ||
+       !starts_with_any(operation, deferrable_operators, sizeof(deferrable_operators) / sizeof(char*)) ||
+       operation[strlen(operation) - 1] != ')' || !find_deferred_inputs(operation, &deferred)) {
+        free(deferred.query);
+        return false;
+    }
+    strncpy(deferred.handle, deferred.query, handle_length);
+    deferred.handle[handle_length] = '\0';
+
+    // a query reading a handle nobody wrote or a column that does not exist runs right away, so
+    // the client gets the error now
+    if(!deferred_columns_exist(operation)) {
+        free(deferred.query);
+        return false;
+    }
+    for(size_t i = 0; i < deferred.num_inputs; i++) {
+        if(find_deferred_writer(context, deferred.inputs[i]) == -1 && lookup_vec(context, deferred.inputs[i]) == NULL) {
+            free(deferred.query);
+            return false;
+        }
+    }
+
+    // only one deferred query writes a handle. The queries reading the result of the earlier
+    // writer run first (the new query too, if it reads its own handle), then the earlier writer
+    // is dead and dropped.
+    int writer = find_deferred_writer(context, deferred.handle);
+    if(writer != -1) {
+        char readers[context->deferred_in_use + 1][HANDLE_MAX_SIZE];
+        char* targets[context->deferred_in_use + 1];
+        size_t num_targets = 0;
+        for(int i = writer + 1; i < context->deferred_in_use; i++) {
+            if(reads_handle(&context->deferred_queries[i], deferred.handle)) {
+                strcpy(readers[num_targets], context->deferred_queries[i].handle);
+                targets[num_targets] = readers[num_targets];
+                num_targets++;
+            }
+        }
+        if(reads_handle(&deferred, deferred.handle)) {
+            strcpy(readers[num_targets], deferred.handle);
+            targets[num_targets] = readers[num_targets];
+            num_targets++;
+        }
+        if(num_targets > 0) {
+            flush_deferred_queries(context, targets, num_targets);
+        }
+        writer = find_deferred_writer(context, deferred.handle);
+        if(writer != -1) {
+            cs165_log(stdout, "Dropped dead query %s\n", context->deferred_queries[writer].query);
+            remove_deferred_query(context, writer);
+        }
+    }
+
+    if(context->deferred_in_use == context->deferred_slots) {
+        context->deferred_slots *= 2;
+        context->deferred_queries = realloc(context->deferred_queries, sizeof(DeferredQuery) * context->deferred_slots);
+    }
+    context->deferred_queries[context->deferred_in_use++] = deferred;
+    return true;
+}
+
+// returns the deferred select of a join side whose values and positions are a deferred fetch of a
+// deferred select, or -1. Neither may read or write a handle the join writes, since they stay
+// deferred after the join, the other side has to run so it cannot read them, and nothing deferred
+// after the select may write the handles it reads.
+int find_scannable_join_side(ClientContext* context, char* values, char* positions, char** other_side, char** join_handles, int* fetch) {
+    DeferredQuery* queries = context->deferred_queries;
+    *fetch = find_deferred_writer(context, values);
+    if(*fetch == -1 || !is_plain_fetch(&queries[*fetch]) || strcmp(queries[*fetch].inputs[0], positions) != 0) {
+        return -1;
+    }
+    int select = find_deferred_writer(context, positions);
+    if(select == -1 || select > *fetch || strncmp(deferred_operation(&queries[select]), "select(", 7) != 0) {
+        return -1;
+    }
+    for(int i = 0; i < 2; i++) {
+        if(strcmp(values, join_handles[i]) == 0 || strcmp(positions, join_handles[i]) == 0 ||
+           reads_handle(&queries[select], join_handles[i]) ||
+           strcmp(values, other_side[i]) == 0 || strcmp(positions, other_side[i]) == 0) {
+            return -1;
+        }
+    }
+    for(size_t i = 0; i < queries[select].num_inputs; i++) {
+        if(find_deferred_writer(context, queries[select].inputs[i]) > select) {
+            return -1;
+        }
+    }
+    return select;
+}
+
+// runs the deferred queries before a join. When one side of the join is a deferred fetch of a deferred
+// select, everything but those two runs, and the join is rewritten to scan that side itself as
+// fetch(col,select(...)), so the rows the other side cannot match are dropped before the fetch.
+// Returns the query to run, a rewritten join is malloced.
+char* flush_deferred_queries_before_join(ClientContext* context, char* command) {
+    // handle1,handle2=join(values1,positions1,values2,positions2[,type[,sorted]])
+    char copy[strlen(command) + 1];
+    strcpy(copy, command);
+    char* arguments = strchr(copy, '=') + 6;
+    // a side written out as fetch(col,select(...)) already scans its table, and its commas are not
+    // the ones between the sides
+    if(copy[strlen(copy) - 1] != ')' || strchr(arguments, '(') != NULL) {
+        flush_deferred_queries(context, NULL, 0);
+        return command;
+    }
+    copy[strlen(copy) - 1] = '\0';
+    char* join_handles[2];
+    char* cur = copy;
+    join_handles[0] = strsep(&cur, ",=");
+    join_handles[1] = strsep(&cur, "=");
+    char* sides[4];
+    for(int i = 0; i < 4; i++) {
+        sides[i] = strsep(&arguments, ",");
+    }
+    if(join_handles[1] == NULL || sides[3] == NULL) {
+        flush_deferred_queries(context, NULL, 0);
+        return command;
+    }
+
+    // the second side is the one scanned when both could be
+    int fetch = -1;
+    int scanned = 1;
+    int select = find_scannable_join_side(context, sides[2], sides[3], sides, join_handles, &fetch);
+    if(select == -1) {
+        scanned = 0;
+        select = find_scannable_join_side(context, sides[0], sides[1], sides + 2, join_handles, &fetch);
+    }
+    if(select == -1) {
+        flush_deferred_queries(context, NULL, 0);
+        return command;
+    }
+
+    // a query reading the values or positions needs the select and the fetch to run after all
+    char others[context->deferred_in_use][HANDLE_MAX_SIZE];
+    char* targets[context->deferred_in_use];
+    size_t num_targets = 0;
+    for(int i = 0; i < context->deferred_in_use; i++) {
+        if(i != select && i != fetch) {
+            strcpy(others[num_targets], context->deferred_queries[i].handle);
+            targets[num_targets] = others[num_targets];
+            num_targets++;
+        }
+    }
+    flush_deferred_queries(context, targets, num_targets);
+    fetch = find_deferred_writer(context, sides[2 * scanned]);
+    select = find_deferred_writer(context, sides[2 * scanned + 1]);
+    if(fetch == -1 || select == -1) {
+        return command;
+    }
+
+    char* fetch_column = deferred_operation(&context->deferred_queries[fetch]) + 6;
+    char* select_operation = deferred_operation(&context->deferred_queries[select]);
+    char scanned_side[strlen(fetch_column) + strlen(select_operation) + 9];
+    sprintf(scanned_side, "fetch(%.*s,%s)", (int)strcspn(fetch_column, ","), fetch_column, select_operation);
+    char* query_command = malloc(strlen(command) + strlen(scanned_side) + 1);
+    char* kept_values = sides[2 - 2 * scanned];
+    char* kept_positions = sides[3 - 2 * scanned];
+    if(scanned == 1) {
+        sprintf(query_command, "%s,%s=join(%s,%s,%s", join_handles[0], join_handles[1], kept_values, kept_positions, scanned_side);
+    }
+    else {
+        sprintf(query_command, "%s,%s=join(%s,%s,%s", join_handles[0], join_handles[1], scanned_side, kept_values, kept_positions);
+    }
+    if(arguments != NULL) {
+        strcat(query_command, ",");
+        strcat(query_command, arguments);
+    }
+    strcat(query_command, ")");
+    cs165_log(stdout, "Pushed the join filter into %s\n", query_command);
+    return query_command;
+}
+
+// runs the deferred queries a query that cannot be deferred depends on: the printed handles for a
+// print, and everything for queries that read handles or change the tables. Returns the query to
+// run, which is the query itself unless a join was rewritten.
+char* flush_deferred_queries_before(ClientContext* context, char* query_command) {
+    if(context->deferred_in_use == 0 || strncmp(query_command, "--", 2) == 0) {
+        return query_command;
+    }
+    char command[strlen(query_command) + 1];
+    strcpy(command, query_command);
+    trim_whitespace(command);
+    if(strncmp(command, "shutdown", 8) == 0) {
+        // nobody can read the handles anymore
+        return query_command;
+    }
+    char* equals_pointer = strchr(command, '=');
+    if(equals_pointer != NULL && strncmp(equals_pointer + 1, "join(", 5) == 0) {
+        char* rewritten = flush_deferred_queries_before_join(context, command);
+        return rewritten == command ? query_command : rewritten;
+    }
+    if(strncmp(command, "print(", 6) != 0 || command[strlen(command) - 1] != ')') {
+        flush_deferred_queries(context, NULL, 0);
+        return query_command;
+    }
+
+    command[strlen(command) - 1] = '\0';
+    char* handles[count_commas(command) + 1];
+    size_t num_handles = 0;
+    char* arguments = command + 6;
+    char* handle;
+    while((handle = strsep(&arguments, ",")) != NULL) {
+        handles[num_handles++] = handle;
+    }
+    flush_deferred_queries(context, handles, num_handles);
+    return query_command;
+}
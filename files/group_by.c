@@ -0,0 +1,382 @@
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "include/group_by.h"
+#include "include/client_context.h"
+#include "include/murmurhash.h"
+#include "include/parallel.h"
+#include "include/radix_sort.h"
+
+void init_groups(Groups* groups, size_t capacity) {
+    groups->keys = malloc(sizeof(int) * capacity);
+    groups->stats = malloc(sizeof(AggregateStats) * capacity);
+    groups->num_groups = 0;
+    groups->capacity = capacity;
+}
+
+void free_groups(Groups* groups) {
+    free(groups->keys);
+    free(groups->stats);
+}
+
+// appends an empty group and returns its number
+size_t add_group(Groups* groups, int key) {
+    if(groups->num_groups == groups->capacity) {
+        groups->capacity *= 2;
+        groups->keys = realloc(groups->keys, sizeof(int) * groups->capacity);
+        groups->stats = realloc(groups->stats, sizeof(AggregateStats) * groups->capacity);
+    }
+    AggregateStats empty = {0, INT_MAX, INT_MIN, 0};
+    groups->keys[groups->num_groups] = key;
+    groups->stats[groups->num_groups] = empty;
+    return groups->num_groups++;
+}
+
+bool keys_in_order(int* keys, size_t num_keys) {
+    for(size_t i = 1; i < num_keys; i++) {
+        if(keys[i] < keys[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// one group per run of equal keys, the values of a run are aggregated in one go
+void group_sorted_runs(int* keys, int* values, size_t num_values, Groups* groups) {
+    size_t start = 0;
+    while(start < num_values) {
+        size_t end = start + 1;
+        while(end < num_values && keys[end] == keys[start]) {
+            end++;
+        }
+        size_t group = add_group(groups, keys[start]);
+        aggregate_values(values + start, end - start, &groups->stats[group]);
+        start = end;
+    }
+}
+
+void group_by_sorting(int* keys, int* values, size_t num_values, Groups* groups) {
+    uint64_t* sort_keys = malloc(sizeof(uint64_t) * num_values);
+    uint64_t* buffer = malloc(sizeof(uint64_t) * num_values);
+    for(size_t i = 0; i < num_values; i++) {
+        sort_keys[i] = key_with_position(keys[i], i);
+    }
+    uint64_t* sorted = parallel_radix_sort(sort_keys, buffer, num_values, 32, 64);
+
+    int* sorted_keys = malloc(sizeof(int) * num_values);
+    int* sorted_values = malloc(sizeof(int) * num_values);
+    for(size_t i = 0; i < num_values; i++) {
+        sorted_keys[i] = key_of(sorted[i]);
+        sorted_values[i] = values[position_of(sorted[i])];
+    }
+    free(sort_keys);
+    free(buffer);
+
+    group_sorted_runs(sorted_keys, sorted_values, num_values, groups);
+    free(sorted_keys);
+    free(sorted_values);
+}
+
+typedef struct GroupByPartition {
+    int* keys;
+    int* values;
+    size_t num_values;
+    Groups groups;
+} GroupByPartition;
+
+// linear probing over slots holding group numbers, the table doubles when half full
+void* hash_group_partition(void* args) {
+    GroupByPartition* partition = (GroupByPartition*) args;
+    Groups* groups = &partition->groups;
+    size_t num_slots = GROUP_BY_INITIAL_TABLE_SIZE;
+    size_t mask = num_slots - 1;
+    size_t* slots = malloc(sizeof(size_t) * num_slots);
+    memset(slots, 0xff, sizeof(size_t) * num_slots);
+
+    init_groups(groups, GROUP_BY_INITIAL_TABLE_SIZE / 2);
+    for(size_t i = 0; i < partition->num_values; i++) {
+        int key = partition->keys[i];
+        size_t slot = murmurhash_int(key) & mask;
+        while(slots[slot] != SIZE_MAX && groups->keys[slots[slot]] != key) {
+            slot = (slot + 1) & mask;
+        }
+        if(slots[slot] == SIZE_MAX) {
+            slots[slot] = add_group(groups, key);
+            if(groups->num_groups * 2 > num_slots) {
+                num_slots *= 2;
+                mask = num_slots - 1;
+                slots = realloc(slots, sizeof(size_t) * num_slots);
+                memset(slots, 0xff, sizeof(size_t) * num_slots);
+                for(size_t group = 0; group < groups->num_groups; group++) {
+                    size_t new_slot = murmurhash_int(groups->keys[group]) & mask;
+                    while(slots[new_slot] != SIZE_MAX) {
+                        new_slot = (new_slot + 1) & mask;
+                    }
+                    slots[new_slot] = group;
+                }
+                slot = murmurhash_int(key) & mask;
+                while(groups->keys[slots[slot]] != key) {
+                    slot = (slot + 1) & mask;
+                }
+            }
+        }
+        AggregateStats* stats = &groups->stats[slots[slot]];
+        int value = partition->values[i];
+        stats->sum += value;
+        stats->min = value < stats->min ? value : stats->min;
+        stats->max = value > stats->max ? value : stats->max;
+        stats->count++;
+    }
+    free(slots);
+    return args;
+}
+
+// scatters the pairs into 2^GROUP_BY_PARTITION_BITS partitions by the top bits of the hash of their key,
+// partition i starts at offsets[i]. values can be NULL when only the keys are needed.
+void partition_by_hash(int* keys, int* values, size_t num_values, size_t* offsets, int* partition_keys, int* partition_values) {
+    size_t num_partitions = 1 << GROUP_BY_PARTITION_BITS;
+    size_t counts[1 << GROUP_BY_PARTITION_BITS];
+    memset(counts, 0, sizeof(counts));
+    for(size_t i = 0; i < num_values; i++) {
+        counts[murmurhash_int(keys[i]) >> (32 - GROUP_BY_PARTITION_BITS)]++;
+    }
+    offsets[0] = 0;
+    for(size_t i = 0; i < num_partitions; i++) {
+        offsets[i + 1] = offsets[i] + counts[i];
+        counts[i] = offsets[i];
+    }
+    for(size_t i = 0; i < num_values; i++) {
+        size_t pos = counts[murmurhash_int(keys[i]) >> (32 - GROUP_BY_PARTITION_BITS)]++;
+        partition_keys[pos] = keys[i];
+        if(values != NULL) {
+            partition_values[pos] = values[i];
+        }
+    }
+}
+
+void group_by_hashing(int* keys, int* values, size_t num_values, Groups* groups) {
+    size_t num_partitions = 1;
+    int* partition_keys = keys;
+    int* partition_values = values;
+    size_t offsets[(1 << GROUP_BY_PARTITION_BITS) + 1];
+    offsets[0] = 0;
+    offsets[1] = num_values;
+
+    // the tables then use the low bits of the hash
+    if(num_values > GROUP_BY_PARTITION_THRESHOLD) {
+        num_partitions = 1 << GROUP_BY_PARTITION_BITS;
+        partition_keys = malloc(sizeof(int) * num_values);
+        partition_values = malloc(sizeof(int) * num_values);
+        partition_by_hash(keys, values, num_values, offsets, partition_keys, partition_values);
+    }
+
+    GroupByPartition* partitions = malloc(sizeof(GroupByPartition) * num_partitions);
+    for(size_t i = 0; i < num_partitions; i++) {
+        partitions[i].keys = partition_keys + offsets[i];
+        partitions[i].values = partition_values + offsets[i];
+        partitions[i].num_values = offsets[i + 1] - offsets[i];
+    }
+    run_tasks_in_parallel(hash_group_partition, partitions, sizeof(GroupByPartition), num_partitions, get_num_cores());
+
+    // the partitions hold disjoint keys, sorting all their groups by key merges them
+    size_t num_groups = 0;
+    for(size_t i = 0; i < num_partitions; i++) {
+        num_groups += partitions[i].groups.num_groups;
+    }
+    uint64_t* sort_keys = malloc(sizeof(uint64_t) * num_groups);
+    uint64_t* buffer = malloc(sizeof(uint64_t) * num_groups);
+    AggregateStats* all_stats = malloc(sizeof(AggregateStats) * num_groups);
+    size_t cur_group = 0;
+    for(size_t i = 0; i < num_partitions; i++) {
+        Groups* partition_groups = &partitions[i].groups;
+        for(size_t j = 0; j < partition_groups->num_groups; j++) {
+            sort_keys[cur_group] = key_with_position(partition_groups->keys[j], cur_group);
+            all_stats[cur_group] = partition_groups->stats[j];
+            cur_group++;
+        }
+        free_groups(partition_groups);
+    }
+    uint64_t* sorted = parallel_radix_sort(sort_keys, buffer, num_groups, 32, 64);
+
+    init_groups(groups, num_groups > 0 ? num_groups : 1);
+    for(size_t i = 0; i < num_groups; i++) {
+        groups->keys[i] = key_of(sorted[i]);
+        groups->stats[i] = all_stats[position_of(sorted[i])];
+    }
+    groups->num_groups = num_groups;
+
+    free(sort_keys);
+    free(buffer);
+    free(all_stats);
+    free(partitions);
+    if(partition_keys != keys) {
+        free(partition_keys);
+        free(partition_values);
+    }
+}
+
+void group_values(int* keys, int* values, size_t num_values, GroupByStrategy strategy, Groups* groups) {
+    if(strategy == GROUP_BY_HASH) {
+        group_by_hashing(keys, values, num_values, groups);
+        return;
+    }
+    bool in_order = keys_in_order(keys, num_values);
+    if(in_order || strategy == GROUP_BY_SORT) {
+        init_groups(groups, GROUP_BY_INITIAL_TABLE_SIZE);
+        if(in_order) {
+            group_sorted_runs(keys, values, num_values, groups);
+        }
+        else {
+            group_by_sorting(keys, values, num_values, groups);
+        }
+        return;
+    }
+    group_by_hashing(keys, values, num_values, groups);
+}
+
+typedef struct DistinctPartition {
+    int* keys;
+    size_t num_values;
+    size_t num_distinct;
+} DistinctPartition;
+
+// inserts the keys into a linear probing set, the table doubles when half full
+void* count_partition_distinct(void* args) {
+    DistinctPartition* partition = (DistinctPartition*) args;
+    size_t num_slots = GROUP_BY_INITIAL_TABLE_SIZE;
+    int* slots = malloc(sizeof(int) * num_slots);
+    bool* used = calloc(num_slots, sizeof(bool));
+    size_t num_distinct = 0;
+    for(size_t i = 0; i < partition->num_values; i++) {
+        int key = partition->keys[i];
+        size_t slot = murmurhash_int(key) & (num_slots - 1);
+        while(used[slot] && slots[slot] != key) {
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        if(used[slot]) {
+            continue;
+        }
+        used[slot] = true;
+        slots[slot] = key;
+        if(++num_distinct * 2 > num_slots) {
+            int* old_slots = slots;
+            bool* old_used = used;
+            num_slots *= 2;
+            slots = malloc(sizeof(int) * num_slots);
+            used = calloc(num_slots, sizeof(bool));
+            for(size_t j = 0; j < num_slots / 2; j++) {
+                if(!old_used[j]) {
+                    continue;
+                }
+                size_t new_slot = murmurhash_int(old_slots[j]) & (num_slots - 1);
+                while(used[new_slot]) {
+                    new_slot = (new_slot + 1) & (num_slots - 1);
+                }
+                used[new_slot] = true;
+                slots[new_slot] = old_slots[j];
+            }
+            free(old_slots);
+            free(old_used);
+        }
+    }
+    free(slots);
+    free(used);
+    partition->num_distinct = num_distinct;
+    return args;
+}
+
+size_t count_distinct_values(int* values, size_t num_values) {
+    if(keys_in_order(values, num_values)) {
+        size_t num_distinct = num_values > 0 ? 1 : 0;
+        for(size_t i = 1; i < num_values; i++) {
+            num_distinct += values[i] != values[i - 1];
+        }
+        return num_distinct;
+    }
+
+    size_t num_partitions = 1;
+    int* partition_keys = values;
+    size_t offsets[(1 << GROUP_BY_PARTITION_BITS) + 1];
+    offsets[0] = 0;
+    offsets[1] = num_values;
+    if(num_values > GROUP_BY_PARTITION_THRESHOLD) {
+        num_partitions = 1 << GROUP_BY_PARTITION_BITS;
+        partition_keys = malloc(sizeof(int) * num_values);
+        partition_by_hash(values, NULL, num_values, offsets, partition_keys, NULL);
+    }
+
+    DistinctPartition partitions[1 << GROUP_BY_PARTITION_BITS];
+    for(size_t i = 0; i < num_partitions; i++) {
+        partitions[i].keys = partition_keys + offsets[i];
+        partitions[i].num_values = offsets[i + 1] - offsets[i];
+    }
+    run_tasks_in_parallel(count_partition_distinct, partitions, sizeof(DistinctPartition), num_partitions, get_num_cores());
+
+    // a key only ever lands in one partition, so their counts add up
+    size_t num_distinct = 0;
+    for(size_t i = 0; i < num_partitions; i++) {
+        num_distinct += partitions[i].num_distinct;
+    }
+    if(partition_keys != values) {
+        free(partition_keys);
+    }
+    return num_distinct;
+}
+
+void execute_group_by(DbOperator* query) {
+    GroupByOperator* group_by = &query->operator_fields.group_by_operator;
+    // parse_group_by only lets int keys and values through
+    size_t num_values = 0;
+    bool is_long = false;
+    int* keys = get_aggregate_input(group_by->keys, &num_values, &is_long);
+    int* values = get_aggregate_input(group_by->values, &num_values, &is_long);
+
+    Groups groups;
+    group_values(keys, values, num_values, group_by->strategy, &groups);
+    size_t num_groups = groups.num_groups;
+
+    Result* key_result = init_result();
+    key_result->num_tuples = num_groups;
+    key_result->payload = groups.keys;
+    key_result->sorted = true;
+
+    Result* aggregate_result = init_result();
+    aggregate_result->num_tuples = num_groups;
+    switch(group_by->type) {
+        case MIN:
+        case MAX:
+        {
+            int* aggregates = malloc(sizeof(int) * num_groups);
+            for(size_t i = 0; i < num_groups; i++) {
+                aggregates[i] = group_by->type == MIN ? groups.stats[i].min : groups.stats[i].max;
+            }
+            aggregate_result->payload = aggregates;
+            break;
+        }
+        case AVG:
+        {
+            double* aggregates = malloc(sizeof(double) * num_groups);
+            for(size_t i = 0; i < num_groups; i++) {
+                aggregates[i] = (double)groups.stats[i].sum / groups.stats[i].count;
+            }
+            aggregate_result->payload = aggregates;
+            aggregate_result->data_type = DOUBLE;
+            break;
+        }
+        default:
+        {
+            long* aggregates = malloc(sizeof(long) * num_groups);
+            for(size_t i = 0; i < num_groups; i++) {
+                aggregates[i] = group_by->type == COUNT ? (long)groups.stats[i].count : groups.stats[i].sum;
+            }
+            aggregate_result->payload = aggregates;
+            aggregate_result->data_type = LONG;
+            break;
+        }
+    }
+    free(groups.stats);
+
+    add_result_to_context(query->context, group_by->handle1, key_result);
+    add_result_to_context(query->context, group_by->handle2, aggregate_result);
+}
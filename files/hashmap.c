@@ -1,74 +1,73 @@
 #include "include/hashmap.h"
 #include "include/murmurhash.h"
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-size_t hashmap_get_index(int key) {
-    size_t pos_num = (size_t)key; 
-    return pos_num % HASHMAP_SIZE; 
-}
-
-
-Hashmap* hashmap_create() {
-    // allocate new hashmap struct
-    Hashmap* new_hashmap = malloc(sizeof(Hashmap));
-    if(!new_hashmap) {
-        return NULL;
+Hashmap* hashmap_build(int* keys, int* positions, size_t num_keys) {
+    size_t num_slots = HASHMAP_MIN_SLOTS;
+    while(num_slots < num_keys * HASHMAP_SLOTS_PER_KEY) {
+        num_slots *= 2;
     }
-    for(int i = 0; i < HASHMAP_SIZE; i++) {
-        new_hashmap->table[i].next_node = NULL;
-    }
-    return new_hashmap; 
-}
-
-int hashmap_get(Hashmap* map, int key) {
-    size_t index = hashmap_get_index(key); 
-    HashmapNode* node = &map->table[index]; 
-
-    while(node != NULL) {
-        for(size_t i = 0; i < node->num_keys; i++) {
-            if(key == node->keys[i]) {
-                return node->positions[i];   
-            } 
+    Hashmap* map = malloc(sizeof(Hashmap));
+    map->mask = num_slots - 1;
+    map->slots = calloc(num_slots + 1, sizeof(HashmapSlot));
+    map->positions = malloc(sizeof(int) * (num_keys > 0 ? num_keys : 1));
+    HashmapSlot* slots = map->slots;
+
+    // first pass: find the slot of every key, while building start counts the positions of the slot
+    uint32_t* key_slots = malloc(sizeof(uint32_t) * (num_keys > 0 ? num_keys : 1));
+    for(size_t i = 0; i < num_keys; i++) {
+        int key = keys[i];
+        size_t slot = murmurhash_int(key) & map->mask;
+        while(slots[slot].start != 0 && slots[slot].key != key) {
+            slot = (slot + 1) & map->mask;
         }
-        node = node->next_node; 
+        slots[slot].key = key;
+        slots[slot].start++;
+        key_slots[i] = (uint32_t)slot;
     }
 
-    return -1;
-}
-
-void hashmap_put(Hashmap* map, int key, int pos) {
-    size_t index = hashmap_get_index(key);
-    HashmapNode* node = &map->table[index];
-    if(node->num_keys == HASHMAP_NODE_SIZE) {
-        HashmapNode* new_node = hashmap_node_create(); 
-        new_node->keys[0] = key;
-        new_node->positions[0] = pos;  
-        new_node->num_keys++;
-        node->next_node = new_node;
+    // the counts become starts, the copy in fill advances as the positions are written
+    uint32_t* fill = malloc(sizeof(uint32_t) * num_slots);
+    uint32_t offset = 0;
+    for(size_t slot = 0; slot < num_slots; slot++) {
+        uint32_t count = slots[slot].start;
+        slots[slot].start = offset;
+        fill[slot] = offset;
+        offset += count;
     }
-    else {
-        node->keys[node->num_keys] = key;
-        node->positions[node->num_keys] = pos; 
-        node->num_keys++; 
+    slots[num_slots].start = offset;
+
+    for(size_t i = 0; i < num_keys; i++) {
+        map->positions[fill[key_slots[i]]++] = positions[i];
     }
+    free(fill);
+    free(key_slots);
+    return map;
 }
 
-HashmapNode* hashmap_node_create() {
-    HashmapNode* new_hashmap_node = malloc(sizeof(HashmapNode));
-    if(!new_hashmap_node) {
-        return NULL;
+size_t hashmap_get(Hashmap* map, int key, int** positions) {
+    HashmapSlot* slots = map->slots;
+    size_t slot = murmurhash_int(key) & map->mask;
+    while(true) {
+        uint32_t start = slots[slot].start;
+        uint32_t end = slots[slot + 1].start;
+        if(start == end) {
+            return 0;
+        }
+        if(slots[slot].key == key) {
+            *positions = map->positions + start;
+            return end - start;
+        }
+        slot = (slot + 1) & map->mask;
     }
-
-    new_hashmap_node->num_keys = 0;
-    new_hashmap_node = NULL;
-    return new_hashmap_node;
 }
 
-
-
-
-
-
+void hashmap_free(Hashmap* map) {
+    free(map->slots);
+    free(map->positions);
+    free(map);
+}
@@ -0,0 +1,91 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/hyperloglog.h"
+#include "include/murmurhash.h"
+#include "include/parallel.h"
+
+// hyperloglog_add_values over more values than this sketches chunks of this size in parallel
+#define HLL_CHUNK_SIZE (1 << 18)
+
+HyperLogLog* create_hyperloglog() {
+    HyperLogLog* sketch = malloc(sizeof(HyperLogLog));
+    memset(sketch->registers, 0, sizeof(sketch->registers));
+    return sketch;
+}
+
+// the top bits of the hash pick the register, the rank is the position of the first one in the rest
+void hyperloglog_add(HyperLogLog* sketch, int value) {
+    uint32_t hash = murmurhash_int(value);
+    uint32_t rest = hash << HLL_PRECISION;
+    uint8_t rank = rest == 0 ? 32 - HLL_PRECISION + 1 : (uint8_t)(__builtin_clz(rest) + 1);
+    uint8_t* reg = &sketch->registers[hash >> (32 - HLL_PRECISION)];
+    *reg = rank > *reg ? rank : *reg;
+}
+
+void hyperloglog_merge(HyperLogLog* into, HyperLogLog* from) {
+    for(size_t i = 0; i < HLL_NUM_REGISTERS; i++) {
+        into->registers[i] = from->registers[i] > into->registers[i] ? from->registers[i] : into->registers[i];
+    }
+}
+
+typedef struct SketchChunk {
+    int* values;
+    size_t num_values;
+    HyperLogLog sketch;
+} SketchChunk;
+
+void* sketch_chunk(void* args) {
+    SketchChunk* chunk = (SketchChunk*) args;
+    memset(chunk->sketch.registers, 0, sizeof(chunk->sketch.registers));
+    for(size_t i = 0; i < chunk->num_values; i++) {
+        hyperloglog_add(&chunk->sketch, chunk->values[i]);
+    }
+    return args;
+}
+
+void hyperloglog_add_values(HyperLogLog* sketch, int* values, size_t num_values) {
+    size_t num_chunks = (num_values + HLL_CHUNK_SIZE - 1) / HLL_CHUNK_SIZE;
+    size_t num_threads = get_num_cores();
+    if(num_chunks < 2 || num_threads < 2) {
+        for(size_t i = 0; i < num_values; i++) {
+            hyperloglog_add(sketch, values[i]);
+        }
+        return;
+    }
+
+    SketchChunk* chunks = malloc(sizeof(SketchChunk) * num_chunks);
+    for(size_t i = 0; i < num_chunks; i++) {
+        size_t first = i * HLL_CHUNK_SIZE;
+        chunks[i].values = values + first;
+        chunks[i].num_values = num_values - first < HLL_CHUNK_SIZE ? num_values - first : HLL_CHUNK_SIZE;
+    }
+    run_tasks_in_parallel(sketch_chunk, chunks, sizeof(SketchChunk), num_chunks, num_threads);
+    for(size_t i = 0; i < num_chunks; i++) {
+        hyperloglog_merge(sketch, &chunks[i].sketch);
+    }
+    free(chunks);
+}
+
+double hyperloglog_estimate(HyperLogLog* sketch) {
+    double m = HLL_NUM_REGISTERS;
+    double inverse_sum = 0;
+    size_t empty_registers = 0;
+    for(size_t i = 0; i < HLL_NUM_REGISTERS; i++) {
+        inverse_sum += ldexp(1.0, -sketch->registers[i]);
+        empty_registers += sketch->registers[i] == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / inverse_sum;
+
+    // small cardinalities leave registers empty, counting those is more accurate there
+    if(estimate <= 2.5 * m && empty_registers > 0) {
+        return m * log(m / empty_registers);
+    }
+    // with 32 bit hashes large cardinalities start to collide
+    double hash_space = 4294967296.0;
+    if(estimate > hash_space / 30) {
+        return -hash_space * log(1 - estimate / hash_space);
+    }
+    return estimate;
+}
@@ -0,0 +1,41 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// min, max, sum and count of a vector, computed together in a single pass
+typedef struct AggregateStats {
+    long sum;
+    int min;
+    int max;
+    size_t count;
+} AggregateStats;
+
+// kernels over int vectors, they keep several independent accumulators so
+// consecutive iterations do not wait on each other and use SSE2 when available
+long sum_values(int* data, size_t num_values);
+int min_values(int* data, size_t num_values);
+int max_values(int* data, size_t num_values);
+void aggregate_values(int* data, size_t num_values, AggregateStats* stats);
+
+// kernels over long vectors, used for the results of add/sub that did not fit an int
+long sum_long_values(long* data, size_t num_values);
+long min_long_values(long* data, size_t num_values);
+long max_long_values(long* data, size_t num_values);
+
+/*
+ * add_values / sub_values
+ * Computes the element wise sum / difference of two int vectors in 32 bit
+ * arithmetic and stores it as ints, overflow is detected from the signs of the
+ * inputs and the result. Returns false if a value wrapped around, the caller
+ * then has to redo the vector with add_long_values / sub_long_values.
+ */
+bool add_values(int* data1, int* data2, size_t num_values, int* out);
+bool sub_values(int* data1, int* data2, size_t num_values, int* out);
+
+// element wise sum / difference into longs, inputs can be either int or long vectors
+void add_long_values(void* data1, bool long1, void* data2, bool long2, size_t num_values, long* out);
+void sub_long_values(void* data1, bool long1, void* data2, bool long2, size_t num_values, long* out);
+
+#endif
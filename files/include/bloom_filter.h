@@ -0,0 +1,59 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "murmurhash.h"
+
+// bits of filter per value added, with BLOOM_BITS_SET bits set per value this keeps false positives
+// around a few percent
+#define BLOOM_BITS_PER_VALUE 16
+#define BLOOM_BITS_SET 4
+
+/*
+ * A register blocked Bloom filter. Every value hashes to one 64 bit block and sets BLOOM_BITS_SET
+ * bits in it, so a lookup reads one word and compares it against a mask. Values that were added
+ * always pass, other values pass with a small false positive rate.
+ */
+typedef struct BloomFilter {
+    uint64_t* blocks;
+    // number of blocks - 1, the number of blocks is a power of two
+    size_t mask;
+} BloomFilter;
+
+// creates an empty filter sized for num_values values
+BloomFilter* create_bloom_filter(size_t num_values);
+
+// the block of a value is picked by the low bits of its hash and the bits inside the block by
+// the high bits of the hash multiplied out to 64 bits
+static inline size_t bloom_block_of(BloomFilter* filter, uint32_t hash) {
+    return hash & filter->mask;
+}
+
+static inline uint64_t bloom_mask_of(uint32_t hash) {
+    uint64_t mixed = (uint64_t)hash * 0x9e3779b97f4a7c15ull;
+    uint64_t mask = 0;
+    for(int i = 0; i < BLOOM_BITS_SET; i++) {
+        mask |= (uint64_t)1 << ((mixed >> (64 - 6 * (i + 1))) & 63);
+    }
+    return mask;
+}
+
+static inline void bloom_filter_add(BloomFilter* filter, int value) {
+    uint32_t hash = murmurhash_int(value);
+    filter->blocks[bloom_block_of(filter, hash)] |= bloom_mask_of(hash);
+}
+
+static inline bool bloom_filter_may_contain(BloomFilter* filter, int value) {
+    uint32_t hash = murmurhash_int(value);
+    uint64_t mask = bloom_mask_of(hash);
+    return (filter->blocks[bloom_block_of(filter, hash)] & mask) == mask;
+}
+
+void bloom_filter_add_values(BloomFilter* filter, int* values, size_t num_values);
+
+void free_bloom_filter(BloomFilter* filter);
+
+#endif
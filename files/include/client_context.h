@@ -14,4 +14,8 @@ Result* lookup_vec(ClientContext* context, char* vector_name);
 size_t lookup_column_index(Column* col);
 
 void add_result_to_context(ClientContext* context, char* handle, Result* result);
+
+Result* lookup_cached_result(ClientContext* context, Fingerprint* fingerprint);
+
+void cache_result(ClientContext* context, Fingerprint* fingerprint, Result* result);
 #endif
@@ -0,0 +1,49 @@
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include "cs165_api.h"
+
+#define COST_MODEL_SAMPLE_SIZE (1 << 22)
+#define COST_MODEL_COMPARATORS 8
+// the parallel calibration scan runs on at most this many cores, each with its own sample,
+// memory bandwidth is saturated well before
+#define COST_MODEL_MAX_PARALLEL_SCANS 8
+
+/*
+ * Hardware costs measured once, the first time a batch is planned.
+ * - scan_cost: seconds to stream one int of a column from memory with one scan running
+ * - parallel_scan_cost: the same when parallel_scans_measured cores stream a column at once (memory bandwidth is shared)
+ * - comparator_cost: seconds to evaluate one comparator on one int already in cache
+ * - predicate_tree_cost: seconds for one int to walk one level of a predicate tree
+ * - num_cores: the number of cores we can run scans on
+ * - parallel_scans_measured: min(num_cores, COST_MODEL_MAX_PARALLEL_SCANS), more scans read at parallel_scan_cost
+ */
+typedef struct CostModel {
+    double scan_cost;
+    double parallel_scan_cost;
+    double comparator_cost;
+    double predicate_tree_cost;
+    size_t num_cores;
+    size_t parallel_scans_measured;
+} CostModel;
+
+/*
+ * How to run the queries of one shared scan group:
+ * queries_per_scan comparators are evaluated by every scan and parallel_scans scans run at once.
+ */
+typedef struct ScanPlan {
+    size_t queries_per_scan;
+    size_t parallel_scans;
+} ScanPlan;
+
+CostModel* get_cost_model();
+
+ScanPlan plan_shared_scans(size_t num_queries, size_t data_length);
+
+double comparators_cost(CostModel* model, size_t num_comparators);
+
+bool use_predicate_tree(size_t num_comparators);
+
+double estimate_shared_scans_time(CostModel* model, size_t num_queries, size_t data_length, size_t queries_per_scan, size_t parallel_scans);
+
+#endif
@@ -30,17 +30,30 @@ SOFTWARE.
 #include <stdio.h>
 #include <pthread.h>
 
+#include "message.h"
+
 // Limits the size of a name in our database to 64 characters
 #define MAX_SIZE_NAME 64
 #define HANDLE_MAX_SIZE 64
 #define DEFAULT_DB_TABLES_CAPACITY 16
 #define DEFAULT_TABLE_CAPACITY 1000000
 #define DEFAULT_RESULT_SIZE 1000000
+#define DEFAULT_RESULT_CACHE_SIZE 32
+// the results a client keeps cached hold at most this many bytes of payload together
+#define DEFAULT_RESULT_CACHE_BYTES ((size_t)64 << 20)
 #define DEFAULT_CLIENT_HANDLES 8
-#define DEFAULT_MAX_SHARED_SCANS 1
+#define DEFAULT_DEFERRED_QUERIES 16
+#define MAX_DEFERRED_QUERY_INPUTS 4
+#define DEFAULT_SHARED_SCAN_CAPACITY 16
+#define DEFAULT_MAX_SHARED_SCANS 256
 #define DEFAULT_MAX_SELECTS_IN_BATCH 10000
-#define MAX_SELECT_THREADS 4
 #define SELECT_VECTOR_SIZE 8096 
+// how many positions ahead a fetch of random positions prefetches
+#define FETCH_PREFETCH_DISTANCE 16
+// a fetch of several columns fetches a block of positions for every column before the next block
+#define FETCH_BLOCK_SIZE 1024
+// aggregates over more values than this are split into chunks of this size between the cores
+#define PARALLEL_AGGREGATE_CHUNK_SIZE (1 << 18)
 #define DATABASE_HOME_DIRECTORY "./databases"
 #define DATABASE_HOME_LIST "./databases/all_databases"
 #define MAX_BTREE_NODE_KEYS 1024
@@ -60,6 +73,16 @@ typedef enum DataType {
      DOUBLE
 } DataType;
 
+/*
+ * the order of the positions a fetch reads. Scans produce sorted and often contiguous positions,
+ * indexes and joins random ones.
+ */
+typedef enum PositionOrder {
+    CONTIGUOUS_POSITIONS,
+    SORTED_POSITIONS,
+    RANDOM_POSITIONS
+} PositionOrder;
+
 struct Comparator;
 struct Table;
 
@@ -113,6 +136,17 @@ typedef struct ColumnIndex {
     IndexFields index_fields; 
 } ColumnIndex; 
 
+/*
+ * cumulative sums of a column, sums[i] is the sum of its first i values, so the sum of any 
+ * position range takes two lookups. Inserts only lower valid_length, the sums from there on 
+ * are rebuilt by the next range sum reaching past it.
+ */
+typedef struct PrefixSum {
+    long* sums;
+    size_t capacity;
+    size_t valid_length;
+} PrefixSum;
+
 typedef struct Column {
     char name[MAX_SIZE_NAME]; 
     int* data;
@@ -120,6 +154,12 @@ typedef struct Column {
     // You will implement column indexes later. 
     struct ColumnIndex *index;
     bool clustered;
+    // NULL unless created with create(idx,<col>,prefix_sum)
+    PrefixSum* prefix_sum;
+    // distinct value sketch, built by the first approximate count_distinct and kept up to date by inserts
+    struct HyperLogLog* sketch;
+    // true while the values are in ascending order, kept up to date by inserts
+    bool sorted;
 } Column;
 
 
@@ -145,6 +185,8 @@ typedef struct Table {
     size_t table_length;
     size_t table_capacity; 
     size_t index_column; 
+    // bumped on every insert, results computed from an older version of the table are stale
+    size_t version;
 } Table;
 
 /**
@@ -197,6 +239,15 @@ typedef struct Result {
     size_t num_tuples;
     DataType data_type;
     void *payload;
+    // the size of a payload that is not num_tuples values of data_type, like the stats of an
+    // aggregate kept in the result cache, 0 otherwise
+    size_t payload_bytes;
+    // never reused between results, operators reading a result are versioned by its id
+    size_t id;
+    // the number of handles and result cache entries sharing the result
+    int ref_count;
+    // true when the values are known to be in ascending order, e.g. fetched in order from a sorted column
+    bool sorted;
 } Result;
 
 /*
@@ -240,11 +291,57 @@ typedef struct ResultHandle {
 /*
  * holds the information necessary to refer to generalized columns (results or columns)
  */
+/*
+ * identifies an operator by its type, its inputs and the versions of the inputs. Columns are
+ * versioned by their table and results by their id, so two operators with the same fingerprint
+ * compute the same result.
+ */
+typedef struct Fingerprint {
+    int operator_type;
+    int aggregate_type;
+    const void* inputs[3];
+    size_t versions[3];
+    long int p_low;
+    long int p_high;
+    ComparatorType type1;
+    ComparatorType type2;
+} Fingerprint;
+
+typedef struct CachedResult {
+    Fingerprint fingerprint;
+    Result* result;
+    // the payload bytes the entry counts against DEFAULT_RESULT_CACHE_BYTES
+    size_t bytes;
+} CachedResult;
+
+/*
+ * a query that runs only once its handle is needed
+ * - query: the DSL line without whitespace
+ * - handle: the handle the query writes
+ * - inputs: the handles the query reads
+ */
+typedef struct DeferredQuery {
+    char* query;
+    char handle[HANDLE_MAX_SIZE];
+    char inputs[MAX_DEFERRED_QUERY_INPUTS][HANDLE_MAX_SIZE];
+    size_t num_inputs;
+} DeferredQuery;
+
 typedef struct ClientContext {
     ResultHandle* chandle_table;
     int chandles_in_use;
     int chandle_slots;
     pthread_mutex_t mutex;
+    // the last results computed by the client, oldest first, evicted in that order
+    CachedResult result_cache[DEFAULT_RESULT_CACHE_SIZE];
+    int cached_results;
+    size_t cached_bytes;
+    // the queries the client sent that did not run yet, in the order they were sent
+    DeferredQuery* deferred_queries;
+    int deferred_in_use;
+    int deferred_slots;
+    // the error of the first deferred query that failed and was not reported yet, OK_DONE if none did
+    message_status deferred_status;
 } ClientContext;
 
 
@@ -275,7 +372,12 @@ typedef enum OperatorType {
     AGGREGATE,
     PRINT,
     BATCH_QUERIES,
-    JOIN
+    JOIN,
+    PIPELINE,
+    GROUP_BY,
+    SORT,
+    TOPK,
+    MULTI_JOIN
 } OperatorType;
 /*
  * necessary fields for insertion
@@ -315,15 +417,34 @@ typedef struct PrintOperator {
     size_t num_columns;
 } PrintOperator; 
 
+/*
+ * fetches the values of the columns at the positions of pos_vec into the handles. 
+ * a,b=fetch(col_a,col_b,pos) reads the positions once for all the columns.
+ */
 typedef struct FetchOperator {
-    GeneralizedColumn* col1; 
-    GeneralizedColumn* col2; 
-    char handle[HANDLE_MAX_SIZE]; 
+    GeneralizedColumn** cols; 
+    size_t num_cols;
+    GeneralizedColumn* pos_vec; 
+    char** handles; 
 } FetchOperator;
 
+/*
+ * the comparators of a select that have to be evaluated. A comparator with a cached result 
+ * reuses it, a comparator repeating an earlier one shares the result of the unique comparator
+ * it repeats.
+ */
+typedef struct CommonSelects {
+    Result** cached;
+    size_t* unique_of;
+    Comparator** unique;
+    Fingerprint* fingerprints;
+    Result** results;
+    size_t num_unique;
+} CommonSelects;
+
 typedef struct ThreadSelect {
     SelectOperator* select; 
-    ClientContext* context;
+    Result** results;
 } ThreadSelect;
 
 
@@ -336,7 +457,12 @@ typedef enum AggregateType{
     SUM,
     AVG,
     ADD,
-    SUB
+    SUB,
+    COUNT,
+    COUNT_DISTINCT,
+    APPROX_COUNT_DISTINCT,
+    // not a query, caches the min, max, sum and count a single pass over a vector computes
+    STATS
 } AggregateType;
 
 typedef struct AggregateOperator {
@@ -346,21 +472,103 @@ typedef struct AggregateOperator {
     char handle[HANDLE_MAX_SIZE];
 } AggregateOperator;
 
+/*
+ * an aggregate over the values a select fetches from a column, e.g. sum(fetch(col2,select(col1,lo,hi))).
+ * Runs one vector at a time without materializing the positions or the values.
+ * count(select(col1,lo,hi)) is a pipeline without fetch_col.
+ */
+typedef struct PipelineOperator {
+    Comparator* comparator;
+    GeneralizedColumn* fetch_col;
+    AggregateType type;
+    char handle[HANDLE_MAX_SIZE];
+} PipelineOperator;
+
 typedef enum JoinType {
     HASH,
-    NESTED
+    NESTED,
+    SORT_MERGE,
+    // a hash join that spills partitions to disk when its table does not fit the memory budget
+    GRACE,
+    // looks up the values of one side in the index of the column the other, scanned, side fetches
+    INDEX,
+    // picks one of the others from the sizes and the sorted flags of the inputs
+    AUTO
 } JoinType; 
 
+/*
+ * t1,t2=join(vals1,pos1,vals2,pos2,hash|nested-loop|sort-merge|grace|index|auto[,sorted]) writes the positions of every matching
+ * pair to t1 and t2, in the order the matches are found or, with sorted, ordered by (pos1, pos2).
+ * One side can be given as fetch(col,select(...)) in place of vals,pos. That side is then scanned
+ * from the columns, and rows whose value fails a Bloom filter of the other side are dropped before
+ * they are fetched and probed. When col has an index an index join skips the scan and looks up
+ * every value of the other side in it instead.
+ */
 typedef struct JoinOperator {
     JoinType type;     
+    bool sorted;
     Result* val_vec1; 
     Result* pos_vec1;
     Result* val_vec2; 
     Result* pos_vec2; 
+    // the select and the fetched column of a side that is scanned, NULL for vals,pos sides
+    Comparator* select1;
+    Column* fetch_col1;
+    Comparator* select2;
+    Column* fetch_col2;
     char handle1[HANDLE_MAX_SIZE];
     char handle2[HANDLE_MAX_SIZE];
 } JoinOperator; 
 
+#define MULTI_JOIN_MAX_DIMENSIONS 8
+
+/*
+ * tf,t1,...,tk=multi_join(fact_pos,fact_key1,dim_vals1,dim_pos1,...,fact_keyk,dim_valsk,dim_posk)
+ * joins the fact tuples, at the positions fact_pos with one key vector per dimension, with every
+ * dimension in one pass. For every combination matching in all dimensions tf gets the fact position
+ * and ti the position in dimension i, in the order of the fact tuples.
+ */
+typedef struct MultiJoinOperator {
+    Result* fact_positions;
+    Result* fact_keys[MULTI_JOIN_MAX_DIMENSIONS];
+    Result* dimension_values[MULTI_JOIN_MAX_DIMENSIONS];
+    Result* dimension_positions[MULTI_JOIN_MAX_DIMENSIONS];
+    size_t num_dimensions;
+    char handles[MULTI_JOIN_MAX_DIMENSIONS + 1][HANDLE_MAX_SIZE];
+} MultiJoinOperator;
+
+typedef enum GroupByStrategy {
+    // hash unless the keys are already in order
+    GROUP_BY_AUTO,
+    GROUP_BY_HASH,
+    GROUP_BY_SORT
+} GroupByStrategy;
+
+/*
+ * k,v=group_by(keys,values,agg[,hash|sort]) writes the distinct keys in ascending order to the 
+ * first handle and the sum, avg, min, max or count of their values to the second.
+ */
+typedef struct GroupByOperator {
+    GeneralizedColumn* keys;
+    GeneralizedColumn* values;
+    AggregateType type;
+    GroupByStrategy strategy;
+    char handle1[HANDLE_MAX_SIZE];
+    char handle2[HANDLE_MAX_SIZE];
+} GroupByOperator;
+
+/*
+ * p=sort(vals) returns the positions of vals in ascending order of their values,
+ * p=topk(vals,k) the positions of its k largest values, largest first.
+ * With a position vector, sort(posn,vals) / topk(posn,vals,k), the positions are taken from posn.
+ */
+typedef struct SortOperator {
+    GeneralizedColumn* positions;
+    GeneralizedColumn* values;
+    size_t k;
+    char handle[HANDLE_MAX_SIZE];
+} SortOperator;
+
 /*
  * union type holding the fields of any operator
  */
@@ -373,6 +581,10 @@ typedef union OperatorFields {
     PrintOperator print_operator;
     BatchOperator batch_operator; 
     JoinOperator join_operator; 
+    PipelineOperator pipeline_operator;
+    GroupByOperator group_by_operator;
+    SortOperator sort_operator;
+    MultiJoinOperator multi_join_operator;
 } OperatorFields;
 /*
  * DbOperator holds the following fields:
@@ -405,6 +617,7 @@ extern int* shutdown_flag;
 // initialization functions
 Table* init_table();
 Column* init_column();
+Result* init_result();
 Db* init_db();
 
 Status sync_db(Db* db);
@@ -418,17 +631,48 @@ Column* create_column(char *name, Table *table, bool sorted, Status *ret_status)
 void execute_insert(DbOperator* query); 
 
 void execute_select(SelectOperator* select_operator, ClientContext* context);
+void select_comparators(Comparator** comparators, size_t num_comparators, Result** results);
 
 void execute_fetch(DbOperator* query);
 
+PositionOrder get_position_order(int* positions, size_t num_positions);
+
+void fetch_values(int* data, int* positions, size_t num_positions, int* values);
+
+void fetch_values_in_order(int* data, int* positions, size_t num_positions, int* values, PositionOrder order);
+
 void execute_load(char* path_name);
 
 void execute_aggregate(DbOperator* query); 
 
+// returns the values of an aggregate input, results of add/sub can hold longs
+void* get_aggregate_input(GeneralizedColumn* col, size_t* data_length, bool* is_long);
+
+void execute_pipeline(DbOperator* query);
+
+void execute_group_by(DbOperator* query);
+
+void execute_sort(DbOperator* query);
+
+void execute_topk(DbOperator* query);
+
 void execute_shutdown(DbOperator* query);
 
 void execute_batch_queries(DbOperator* query);
 
+void select_unsorted_data_shared(int* data, Comparator* comparator, Result* result, size_t cur_loc, size_t vector_size, size_t data_length);
+
+void select_unsorted_data_with_pos_vec_shared(int* data, int* pos_vec, Comparator* comparator, Result* result, size_t cur_loc, size_t vector_size, size_t data_length);
+
+size_t get_comparator_data_length(Comparator* comparator);
+
+void select_vector(Comparator* comparator, size_t cur_loc, Result* positions);
+
+void select_from_index(ColumnIndex* index, Comparator* comparator, Result* result, size_t data_len);
+
+// firsts[i] is the first entry of the sorted index whose value is not below keys[i]
+void sorted_index_lower_bounds(SortedIndex* index, size_t data_len, int* keys, size_t num_keys, size_t* firsts);
+
 // shutdown operations
 Status shutdown_server();
 
@@ -445,6 +689,7 @@ void write_column_to_disk(Column* column, Table* table, char* dir);
 char* execute_db_operator(DbOperator* query);
 /* char** execute_db_operator(DbOperator* query); */
 void free_db_operator(DbOperator* query);
+void free_join_selects(JoinOperator* join);
 
 void free_db(Db* db);
 void free_table(Table* table);
@@ -462,11 +707,18 @@ Table* load_table_from_disk(char* table_name, char* dir);
 Column* load_column_from_disk(char* column_name, char* dir, Table* table); 
 
 //index operations
+PrefixSum* create_prefix_sum();
+long prefix_range_sum(Column* column, size_t first, size_t last);
 BtreeNode* btree_create();
 void select_from_btree_index(BtreeIndex* index, Comparator* comparator, Result* result); 
 void insert_to_unclustered_btree_index(BtreeIndex* index, int val, size_t orig_pos, bool last_val); 
 size_t insert_to_clustered_btree_index(BtreeIndex* index, int val);
 void get_btree_values(BtreeIndex* index, int* ret);
+bool btree_min(BtreeIndex* index, int* min);
+bool btree_max(BtreeIndex* index, int* max);
+void btree_lower_bounds(BtreeIndex* index, int* keys, size_t num_keys, BtreeNode** leaves, int* slots);
+struct AggregateStats;
+void aggregate_btree_range(BtreeIndex* index, Comparator* comparator, struct AggregateStats* stats);
 void free_btree(BtreeNode* root); 
 
 #endif /* CS165_H */
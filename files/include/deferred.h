@@ -0,0 +1,28 @@
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+#include "cs165_api.h"
+
+/*
+ * Queries that only write a handle (select, fetch and the aggregates) are not executed when
+ * the client sends them. They are recorded in the client context and run once a print, or a 
+ * query that cannot be deferred, needs their handles. Queries whose handle is overwritten 
+ * before anything reads it never run, and an aggregate over a fetch of a select runs as one 
+ * fused pipeline when only the aggregate is needed. Fetches of the same positions that run in
+ * the same flush are merged into one multi column fetch.
+ *
+ * A relational_insert or a load runs every deferred query first, so deferred queries see the
+ * tables as they were when the client sent them. A deferred query reading a missing handle or
+ * column runs right away and fails then. Any other error of a deferred query is sent with the
+ * next reply to the client.
+ */
+
+bool defer_query(ClientContext* context, char* query_command);
+
+void flush_deferred_queries(ClientContext* context, char** handles, size_t num_handles);
+
+// runs the deferred queries the query depends on and returns the query to run in its place. A join
+// reading a deferred fetch of a deferred select comes back malloced, rewritten to scan that side itself.
+char* flush_deferred_queries_before(ClientContext* context, char* query_command);
+
+#endif
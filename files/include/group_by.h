@@ -0,0 +1,35 @@
+#ifndef GROUP_BY_H
+#define GROUP_BY_H
+
+#include "cs165_api.h"
+#include "aggregate.h"
+
+// inputs longer than this are split into hash partitions first, so the table of every partition stays in cache
+#define GROUP_BY_PARTITION_THRESHOLD (1 << 16)
+// the number of hash partitions is 2^GROUP_BY_PARTITION_BITS, taken from the top bits of the hash
+#define GROUP_BY_PARTITION_BITS 6
+#define GROUP_BY_INITIAL_TABLE_SIZE 1024
+
+// the groups of an input, one key and the stats of its values per group
+typedef struct Groups {
+    int* keys;
+    AggregateStats* stats;
+    size_t num_groups;
+    size_t capacity;
+} Groups;
+
+/*
+ * group_values
+ * Groups the values by their keys and returns the groups ordered by key.
+ * - GROUP_BY_HASH: hash table per partition, the partitions run in parallel
+ * - GROUP_BY_SORT: radix sorts the keys (skipped when they already are in order) and aggregates the runs
+ * - GROUP_BY_AUTO: sort when the keys are in order, hash otherwise
+ */
+void group_values(int* keys, int* values, size_t num_values, GroupByStrategy strategy, Groups* groups);
+
+void free_groups(Groups* groups);
+
+// returns the exact number of distinct values, hashed in partitions like group_values unless they are in order
+size_t count_distinct_values(int* values, size_t num_values);
+
+#endif
@@ -1,35 +1,40 @@
 #ifndef HASHMAP_H
 #define HASHMAP_H
 
-#include <stdio.h>
-#define HASHMAP_SIZE 4096
-#define HASHMAP_NODE_SIZE 1024
-
-
-typedef struct HashmapNode {
-    int keys[HASHMAP_NODE_SIZE]; 
-    int positions[HASHMAP_NODE_SIZE]; 
-    struct HashmapNode* next_node;  
-    size_t num_keys; 
-} HashmapNode;
-
+#include <stddef.h>
+#include <stdint.h>
+
+// the table has at least this many slots for every key it is built from, so probes stay short
+#define HASHMAP_SLOTS_PER_KEY 2
+#define HASHMAP_MIN_SLOTS 16
+
+/*
+ * a slot of the table, start is where the positions of its key begin in the positions array and
+ * the start of the next slot is where they end, so an empty slot starts where the next one does
+ */
+typedef struct HashmapSlot {
+    int key;
+    uint32_t start;
+} HashmapSlot;
+
+/*
+ * Hash table from keys to all the positions they appear at, used as the build side of hash joins.
+ * Open addressing with linear probing over a power of two number of slots. The positions of every
+ * key are stored contiguously, in the order they were given to hashmap_build.
+ */
 typedef struct Hashmap {
-    HashmapNode table[HASHMAP_SIZE]; 
+    // num_slots + 1 slots, the last one only marks the end of the positions
+    HashmapSlot* slots;
+    size_t mask;
+    int* positions;
 } Hashmap;
 
+// builds the table of the num_keys (key, position) pairs in one go, sized from num_keys
+Hashmap* hashmap_build(int* keys, int* positions, size_t num_keys);
 
-/* hashmap_fatnode* hashmap_node_create() */
-
-// get the index into the hashmap array for the input key
-size_t hashmap_get_index(int key); 
+// returns the number of positions stored for key and points positions at the first of them
+size_t hashmap_get(Hashmap* map, int key, int** positions);
 
-Hashmap* hashmap_create();
-
-HashmapNode* hashmap_node_create();
-
-int hashmap_get(Hashmap* map, int key);
-
-void hashmap_put(Hashmap* map, int key, int data);
+void hashmap_free(Hashmap* map);
 
 #endif
-
@@ -0,0 +1,32 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 2^HLL_PRECISION registers of a byte each, the standard error of the estimate is 1.04 / sqrt(2^HLL_PRECISION)
+#define HLL_PRECISION 12
+#define HLL_NUM_REGISTERS (1 << HLL_PRECISION)
+
+/*
+ * A HyperLogLog sketch of the distinct values of a vector. Every value hashes to a register, 
+ * which keeps the longest run of leading zeros seen in the rest of the hashes that went there.
+ */
+typedef struct HyperLogLog {
+    uint8_t registers[HLL_NUM_REGISTERS];
+} HyperLogLog;
+
+HyperLogLog* create_hyperloglog();
+
+void hyperloglog_add(HyperLogLog* sketch, int value);
+
+// adds the values of a vector, longer vectors are split between the cores
+void hyperloglog_add_values(HyperLogLog* sketch, int* values, size_t num_values);
+
+// merges the sketch from into into, the result sketches the union of both vectors
+void hyperloglog_merge(HyperLogLog* into, HyperLogLog* from);
+
+// returns the estimated number of distinct values added to the sketch
+double hyperloglog_estimate(HyperLogLog* sketch);
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef JOIN_H
+#define JOIN_H
+
+#include "cs165_api.h"
+
+// hash partitions of the build side hold about this many tuples, so their tables stay in L2
+#define JOIN_PARTITION_SIZE (1 << 14)
+// hash bits every partitioning pass splits on, 2^JOIN_RADIX_BITS_PER_PASS partitions per pass
+// keep the number of pages written to at once below the TLB size
+#define JOIN_RADIX_BITS_PER_PASS 6
+#define JOIN_MAX_RADIX_BITS 18
+// an auto join compares every pair with a nested loop when there are at most this many pairs
+#define JOIN_NESTED_LOOP_MAX_PAIRS (1 << 16)
+// or when one side has at most this many values, scanning them with SIMD compares for every value
+// of the other side beats building and probing a hash table
+#define JOIN_NESTED_LOOP_MAX_SMALL_SIDE 64
+// nested loop tasks compare tiles of this many probe values against build tiles of this many values
+#define JOIN_NESTED_LOOP_TILE_SIZE 4096
+// build values one probe value is compared against per step of the nested loop: two 4-lane SSE2
+// compares
+#define JOIN_NESTED_LOOP_LANES 8
+
+// an auto join looks up the values of one side in the index of a scanned side, in place of scanning
+// it, when the indexed table has at least this many times as many rows as the other side has values
+#define JOIN_INDEX_PROBE_RATIO 64
+// index join tasks look up tiles of this many values, in batches of JOIN_INDEX_BATCH_SIZE lookups
+// that run in lockstep so their cache misses overlap
+#define JOIN_INDEX_TILE_SIZE 4096
+#define JOIN_INDEX_BATCH_SIZE 16
+
+// a hash join whose table would take more memory than this spills both relations to partition
+// files under JOIN_SPILL_DIRECTORY and joins the partitions one pair at a time. Compile with
+// -DJOIN_MEMORY_BUDGET=<bytes> to change it.
+#ifndef JOIN_MEMORY_BUDGET
+#define JOIN_MEMORY_BUDGET ((size_t)256 << 20)
+#endif
+// compile with -DJOIN_SPILL_DIRECTORY=\"<dir>\" to spill elsewhere, a directory that cannot be
+// written makes every grace join fall back to the in-memory hash join
+#ifndef JOIN_SPILL_DIRECTORY
+#define JOIN_SPILL_DIRECTORY DATABASE_HOME_DIRECTORY
+#endif
+// estimated hash join memory per build tuple: its table slots, its position and its partition copies
+#define JOIN_BYTES_PER_BUILD_TUPLE 32
+// most spill partitions one pass writes, every partition has an open file and a write buffer
+#define JOIN_MAX_SPILL_PARTITIONS 64
+// tuples buffered per spill partition before they are written out
+#define JOIN_SPILL_BUFFER_SIZE 4096
+// partitions still over the budget are spilled again with another hash, up to this many times
+#define JOIN_MAX_SPILL_DEPTH 3
+
+// one side of a join, the value and the position of every tuple
+typedef struct JoinRelation {
+    int* values;
+    int* positions;
+    size_t length;
+} JoinRelation;
+
+// a filled buffer of matches, kept in the chunk list of a JoinMatches until they are collected
+typedef struct JoinMatchChunk {
+    int* positions1;
+    int* positions2;
+    size_t num_matches;
+    struct JoinMatchChunk* next;
+} JoinMatchChunk;
+
+// matches are added to a buffer of at most this many pairs, a filled buffer moves to the chunk
+// list and the next one is twice as large up to this size, nothing that was found is copied
+#define JOIN_MATCH_CHUNK_SIZE ((size_t)1 << 22)
+
+/*
+ * The matches of a join as pairs of positions, appended in the order they are found. The filled
+ * chunks come first, positions1 and positions2 are the buffer matches are currently added to.
+ * collect_join_matches turns them into one pair of vectors of exactly num_matches.
+ */
+typedef struct JoinMatches {
+    int* positions1;
+    int* positions2;
+    size_t num_matches;
+    size_t capacity;
+    JoinMatchChunk* first_chunk;
+    JoinMatchChunk* last_chunk;
+    // matches in the chunk list
+    size_t num_chunked;
+    // matches expected per tuple of the larger relation, sizes the first buffer of every join task
+    double expected_per_tuple;
+} JoinMatches;
+
+void init_join_matches(JoinMatches* matches, size_t capacity);
+
+// moves the filled buffer to the chunk list and starts a larger one
+void grow_join_matches(JoinMatches* matches);
+
+static inline void add_join_match(JoinMatches* matches, int pos1, int pos2) {
+    if(matches->num_matches == matches->capacity) {
+        grow_join_matches(matches);
+    }
+    matches->positions1[matches->num_matches] = pos1;
+    matches->positions2[matches->num_matches] = pos2;
+    matches->num_matches++;
+}
+
+static inline size_t count_join_matches(JoinMatches* matches) {
+    return matches->num_chunked + matches->num_matches;
+}
+
+// moves all the matches, in order, to positions1 and positions2 and shrinks them to fit
+void collect_join_matches(JoinMatches* matches);
+
+/*
+ * estimate_join_matches
+ * Estimates the size of the join from HyperLogLog sketches of the values of both relations,
+ * assuming the values of the relation with fewer distinct values all occur in the other one and
+ * every value is equally frequent: length1 * length2 / max(distinct1, distinct2).
+ */
+size_t estimate_join_matches(JoinRelation* relation1, JoinRelation* relation2);
+
+// collects the matches and orders them by (pos1, pos2), the two vectors stay paired
+void sort_join_matches(JoinMatches* matches);
+
+/*
+ * hash_join
+ * Adds the matches of the two relations to matches, positions of relation1 go to positions1.
+ * A build side larger than JOIN_PARTITION_SIZE is radix partitioned on the hashes of the values
+ * first, then every pair of partitions is joined with its own table. Partitioning, build and
+ * probe all run in parallel.
+ */
+void hash_join(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches);
+
+/*
+ * grace_hash_join
+ * Joins like hash_join while the table of the smaller relation fits in JOIN_MEMORY_BUDGET. Larger
+ * joins write both relations to spill files, partitioned on a hash independent of the one the
+ * tables use, and join every pair of partitions in turn, spilling again the ones still too large.
+ * When the files cannot be written the join runs in memory.
+ */
+void grace_hash_join(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches);
+
+/*
+ * sort_merge_join
+ * Sorts the relations by value, unless their sorted flag says they already are, and merges them.
+ * The matches come out ordered by value.
+ */
+void sort_merge_join(JoinRelation* relation1, bool sorted1, JoinRelation* relation2, bool sorted2, JoinMatches* matches);
+
+/*
+ * nested_loop_join
+ * Compares every value of the larger relation against the values of the smaller one, which stays
+ * in cache, JOIN_NESTED_LOOP_LANES at a time with SIMD compares. Tiles of the larger relation run
+ * in parallel and their matches are appended in tile order.
+ */
+void nested_loop_join(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches);
+
+/*
+ * index_nested_loop_join
+ * Looks up every value of probe in the index of column and matches it with the rows of the column
+ * holding that value that select, a comparator over a column of the same table, qualifies. There is
+ * no build phase. Tiles of probe run in parallel and their matches are appended in tile order. The
+ * positions of probe go to positions1 when probe_first is true.
+ */
+void index_nested_loop_join(JoinRelation* probe, Column* column, Comparator* select, bool probe_first, JoinMatches* matches);
+
+// a multi-way join hands every task this many fact tuples, and probes them through the dimensions
+// MULTI_JOIN_VECTOR_SIZE at a time
+#define MULTI_JOIN_CHUNK_SIZE (1 << 16)
+#define MULTI_JOIN_VECTOR_SIZE 1024
+
+/*
+ * multi_join
+ * Joins the fact tuples, given by their positions and one key vector per dimension, with all the
+ * dimensions in one pass: every vector of fact tuples probes the table of the first dimension, the
+ * ones that match probe the next and so on. outputs[0] gets the fact positions of the combinations
+ * that match in every dimension, outputs[i + 1] their positions in dimension i. The outputs are
+ * malloced, returns the number of combinations.
+ */
+size_t multi_join(int* fact_positions, int** fact_keys, size_t num_facts, JoinRelation* dimensions, size_t num_dimensions, int** outputs);
+
+void execute_multi_join(DbOperator* query);
+
+// the join type an auto join runs for inputs of these lengths and sorted flags
+JoinType choose_join_type(size_t length1, bool sorted1, size_t length2, bool sorted2);
+
+void execute_join(DbOperator* query);
+
+#endif
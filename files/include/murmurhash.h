@@ -23,6 +23,14 @@ extern "C" {
     uint32_t
         murmurhash (const char *, uint32_t, uint32_t);
 
+    /**
+     * Returns a murmur hash of a single int, much cheaper than
+     * hashing its 4 bytes with `murmurhash'
+     */
+
+    uint32_t
+        murmurhash_int (int);
+
 #ifdef __cplusplus
 }
 #endif
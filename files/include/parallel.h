@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdlib.h>
+
+// returns the number of cores available to the server
+size_t get_num_cores();
+
+// Calls routine on every one of the num_tasks arguments stored one after the other in args 
+// (each arg_size bytes), using at most num_threads threads. Tasks are handed out one at a time 
+// so tasks of uneven cost still balance between the threads. Runs inline with one thread.
+void run_tasks_in_parallel(void* (*routine)(void*), void* args, size_t arg_size, size_t num_tasks, size_t num_threads);
+
+#endif
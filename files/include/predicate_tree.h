@@ -0,0 +1,38 @@
+#ifndef PREDICATE_TREE_H
+#define PREDICATE_TREE_H
+
+#include "cs165_api.h"
+
+/*
+ * PredicateTree
+ * Indexes the range predicates of a shared scan so every row finds the predicates it 
+ * satisfies in logarithmic time instead of being compared against every one of them.
+ * - bounds: the sorted distinct bounds of all predicates. They cut the values into 
+ *   num_bounds + 1 elementary intervals, the leaves of the tree.
+ * - a segment tree over the leaves (tree_size of them, rounded to a power of two) stores 
+ *   every predicate in the nodes that exactly cover its range. The predicates of node i are
+ *   node_predicates[node_offsets[i]] up to node_predicates[node_offsets[i + 1]].
+ *   A row satisfies exactly the predicates stored on the path from its leaf to the root. 
+ * - identical comparators share one predicate, comparator_predicates maps every comparator to it.
+ */
+typedef struct PredicateTree {
+    long* bounds;
+    size_t num_bounds;
+    size_t tree_size;
+    size_t* node_offsets;
+    size_t* node_predicates;
+    size_t num_predicates;
+    size_t* comparator_predicates;
+} PredicateTree;
+
+PredicateTree* predicate_tree_create(Comparator** comparators, size_t num_comparators);
+
+void free_predicate_tree(PredicateTree* tree);
+
+size_t predicate_tree_depth(size_t num_comparators);
+
+// adds every row of data in [cur_loc, cur_loc + vector_size) to the results of the predicates 
+// it satisfies. If pos_vec is not NULL the positions it holds are added instead of the row numbers.
+void predicate_tree_select(PredicateTree* tree, int* data, int* pos_vec, Result** results, size_t cur_loc, size_t vector_size, size_t data_length);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// number of key bits sorted by every pass of the radix sort
+#define RADIX_BITS 8
+// inputs longer than this are sorted by parallel_radix_sort on several cores
+#define PARALLEL_SORT_THRESHOLD (1 << 18)
+
+/*
+ * radix_sort
+ * Sorts the keys by bits low_bit up to (excluding) high_bit with a stable LSD radix sort, 
+ * the other bits can carry a payload such as the original position of the key.
+ * buffer has to hold num_keys keys, the passes alternate between keys and buffer.
+ * Returns the one of them holding the sorted keys.
+ */
+uint64_t* radix_sort(uint64_t* keys, uint64_t* buffer, size_t num_keys, int low_bit, int high_bit);
+
+/*
+ * parallel_radix_sort
+ * Same contract as radix_sort. The keys are first split by their top digit, the histogram 
+ * and the scatter of that pass are shared between the cores, then every bucket is sorted on
+ * the remaining bits as a task of its own.
+ */
+uint64_t* parallel_radix_sort(uint64_t* keys, uint64_t* buffer, size_t num_keys, int low_bit, int high_bit);
+
+// an int key goes to the top 32 bits with its sign flipped so unsigned order is int order,
+// the low 32 bits carry a position along through the sort
+static inline uint64_t key_with_position(int key, size_t pos) {
+    return ((uint64_t)((uint32_t)key ^ 0x80000000u) << 32) | (uint64_t)pos;
+}
+
+static inline int key_of(uint64_t key_with_pos) {
+    return (int)((uint32_t)(key_with_pos >> 32) ^ 0x80000000u);
+}
+
+static inline size_t position_of(uint64_t key_with_pos) {
+    return (size_t)(key_with_pos & 0xffffffffu);
+}
+
+// returns the number of bits needed to represent values up to max_value
+int radix_bits_needed(uint64_t max_value);
+
+#endif
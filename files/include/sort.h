@@ -0,0 +1,23 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include "cs165_api.h"
+
+// top-k over more values than this keeps one heap per chunk of this size, chunks run in parallel
+#define TOP_K_CHUNK_SIZE (1 << 18)
+
+/*
+ * sort_positions
+ * Writes the positions 0..num_values-1 of values to out in ascending order of their values,
+ * equal values keep their order.
+ */
+void sort_positions(int* values, size_t num_values, int* out);
+
+/*
+ * top_k_positions
+ * Writes the positions of the k largest values to out, largest first, and returns how many
+ * were written (less than k when there are fewer values). Of equal values the earlier one ranks higher.
+ */
+size_t top_k_positions(int* values, size_t num_values, size_t k, int* out);
+
+#endif
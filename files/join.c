@@ -0,0 +1,1159 @@
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "include/join.h"
+#include "include/bloom_filter.h"
+#include "include/client_context.h"
+#include "include/hashmap.h"
+#include "include/hyperloglog.h"
+#include "include/murmurhash.h"
+#include "include/parallel.h"
+#include "include/radix_sort.h"
+#include "include/utils.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void init_join_matches(JoinMatches* matches, size_t capacity) {
+    matches->capacity = capacity > 0 ? capacity : 1;
+    matches->capacity = matches->capacity < JOIN_MATCH_CHUNK_SIZE ? matches->capacity : JOIN_MATCH_CHUNK_SIZE;
+    matches->positions1 = malloc(sizeof(int) * matches->capacity);
+    matches->positions2 = malloc(sizeof(int) * matches->capacity);
+    matches->num_matches = 0;
+    matches->first_chunk = NULL;
+    matches->last_chunk = NULL;
+    matches->num_chunked = 0;
+    matches->expected_per_tuple = 1;
+}
+
+// moves the current buffer to the end of the chunk list, a partly filled one is shrunk to fit and
+// an empty one freed. The matches have no buffer afterwards.
+static void push_join_match_chunk(JoinMatches* matches) {
+    if(matches->num_matches == 0) {
+        free(matches->positions1);
+        free(matches->positions2);
+    }
+    else {
+        if(matches->num_matches < matches->capacity) {
+            matches->positions1 = realloc(matches->positions1, sizeof(int) * matches->num_matches);
+            matches->positions2 = realloc(matches->positions2, sizeof(int) * matches->num_matches);
+        }
+        JoinMatchChunk* chunk = malloc(sizeof(JoinMatchChunk));
+        chunk->positions1 = matches->positions1;
+        chunk->positions2 = matches->positions2;
+        chunk->num_matches = matches->num_matches;
+        chunk->next = NULL;
+        if(matches->last_chunk == NULL) {
+            matches->first_chunk = chunk;
+        }
+        else {
+            matches->last_chunk->next = chunk;
+        }
+        matches->last_chunk = chunk;
+        matches->num_chunked += matches->num_matches;
+    }
+    matches->positions1 = NULL;
+    matches->positions2 = NULL;
+    matches->num_matches = 0;
+    matches->capacity = 0;
+}
+
+void grow_join_matches(JoinMatches* matches) {
+    size_t capacity = matches->capacity < JOIN_MATCH_CHUNK_SIZE / 2 ? matches->capacity * 2 : JOIN_MATCH_CHUNK_SIZE;
+    push_join_match_chunk(matches);
+    matches->capacity = capacity;
+    matches->positions1 = malloc(sizeof(int) * capacity);
+    matches->positions2 = malloc(sizeof(int) * capacity);
+}
+
+// appends the matches of from to matches, its chunks are linked in and its buffer becomes the one
+// matches are added to
+static void append_join_matches(JoinMatches* matches, JoinMatches* from) {
+    push_join_match_chunk(matches);
+    if(from->first_chunk != NULL) {
+        if(matches->last_chunk == NULL) {
+            matches->first_chunk = from->first_chunk;
+        }
+        else {
+            matches->last_chunk->next = from->first_chunk;
+        }
+        matches->last_chunk = from->last_chunk;
+        matches->num_chunked += from->num_chunked;
+    }
+    matches->positions1 = from->positions1;
+    matches->positions2 = from->positions2;
+    matches->num_matches = from->num_matches;
+    matches->capacity = from->capacity;
+}
+
+void collect_join_matches(JoinMatches* matches) {
+    if(matches->first_chunk == NULL) {
+        // all of them are in the buffer already, only its unused end is given back
+        if(matches->num_matches < matches->capacity) {
+            matches->capacity = matches->num_matches > 0 ? matches->num_matches : 1;
+            matches->positions1 = realloc(matches->positions1, sizeof(int) * matches->capacity);
+            matches->positions2 = realloc(matches->positions2, sizeof(int) * matches->capacity);
+        }
+        return;
+    }
+    size_t num_matches = count_join_matches(matches);
+    int* positions1 = malloc(sizeof(int) * num_matches);
+    int* positions2 = malloc(sizeof(int) * num_matches);
+    push_join_match_chunk(matches);
+    size_t offset = 0;
+    JoinMatchChunk* chunk = matches->first_chunk;
+    while(chunk != NULL) {
+        memcpy(positions1 + offset, chunk->positions1, sizeof(int) * chunk->num_matches);
+        memcpy(positions2 + offset, chunk->positions2, sizeof(int) * chunk->num_matches);
+        offset += chunk->num_matches;
+        JoinMatchChunk* next = chunk->next;
+        free(chunk->positions1);
+        free(chunk->positions2);
+        free(chunk);
+        chunk = next;
+    }
+    matches->positions1 = positions1;
+    matches->positions2 = positions2;
+    matches->num_matches = num_matches;
+    matches->capacity = num_matches;
+    matches->first_chunk = NULL;
+    matches->last_chunk = NULL;
+    matches->num_chunked = 0;
+}
+
+// distinct values of a relation, never more than it has tuples
+static double estimate_distinct(JoinRelation* relation) {
+    HyperLogLog* sketch = create_hyperloglog();
+    hyperloglog_add_values(sketch, relation->values, relation->length);
+    double distinct = hyperloglog_estimate(sketch);
+    free(sketch);
+    return distinct < (double)relation->length ? distinct : (double)relation->length;
+}
+
+size_t estimate_join_matches(JoinRelation* relation1, JoinRelation* relation2) {
+    if(relation1->length == 0 || relation2->length == 0) {
+        return 0;
+    }
+    double distinct1 = estimate_distinct(relation1);
+    double distinct2 = estimate_distinct(relation2);
+    double distinct = distinct1 > distinct2 ? distinct1 : distinct2;
+    double pairs = (double)relation1->length * (double)relation2->length;
+    double estimate = distinct >= 1 ? pairs / distinct : pairs;
+    return (size_t)(estimate < pairs ? estimate : pairs);
+}
+
+// packs both positions into one key of just enough bits, so one radix sort orders the pairs
+void sort_join_matches(JoinMatches* matches) {
+    collect_join_matches(matches);
+    size_t num_matches = matches->num_matches;
+    int max_position1 = 0;
+    int max_position2 = 0;
+    for(size_t i = 0; i < num_matches; i++) {
+        max_position1 = matches->positions1[i] > max_position1 ? matches->positions1[i] : max_position1;
+        max_position2 = matches->positions2[i] > max_position2 ? matches->positions2[i] : max_position2;
+    }
+    int bits1 = radix_bits_needed((uint64_t)max_position1);
+    int bits2 = radix_bits_needed((uint64_t)max_position2);
+
+    uint64_t* keys = malloc(sizeof(uint64_t) * num_matches);
+    uint64_t* buffer = malloc(sizeof(uint64_t) * num_matches);
+    for(size_t i = 0; i < num_matches; i++) {
+        keys[i] = ((uint64_t)matches->positions1[i] << bits2) | (uint64_t)matches->positions2[i];
+    }
+    uint64_t* sorted = parallel_radix_sort(keys, buffer, num_matches, 0, bits1 + bits2);
+    uint64_t mask2 = ((uint64_t)1 << bits2) - 1;
+    for(size_t i = 0; i < num_matches; i++) {
+        matches->positions1[i] = (int)(sorted[i] >> bits2);
+        matches->positions2[i] = (int)(sorted[i] & mask2);
+    }
+    free(keys);
+    free(buffer);
+}
+
+// the partitions split on the top bits of the hash, the tables of the partitions use the low bits
+static inline size_t partition_of(int value, int shift, int bits) {
+    return (murmurhash_int(value) >> shift) & ((1 << bits) - 1);
+}
+
+typedef struct PartitionChunk {
+    JoinRelation in;
+    // the start of the output of the whole range the chunk is part of
+    JoinRelation out;
+    int shift;
+    int bits;
+    // the histogram of the chunk, then where its tuples of every partition go in out
+    size_t counts[1 << JOIN_RADIX_BITS_PER_PASS];
+} PartitionChunk;
+
+void* count_partition_chunk(void* args) {
+    PartitionChunk* chunk = (PartitionChunk*) args;
+    memset(chunk->counts, 0, sizeof(chunk->counts));
+    for(size_t i = 0; i < chunk->in.length; i++) {
+        chunk->counts[partition_of(chunk->in.values[i], chunk->shift, chunk->bits)]++;
+    }
+    return args;
+}
+
+void* scatter_partition_chunk(void* args) {
+    PartitionChunk* chunk = (PartitionChunk*) args;
+    for(size_t i = 0; i < chunk->in.length; i++) {
+        size_t pos = chunk->counts[partition_of(chunk->in.values[i], chunk->shift, chunk->bits)]++;
+        chunk->out.values[pos] = chunk->in.values[i];
+        chunk->out.positions[pos] = chunk->in.positions[i];
+    }
+    return args;
+}
+
+/*
+ * Partitions in into out on bits hash bits from shift, the histogram and the scatter are split
+ * into num_chunks chunks that run in parallel. Writes the start of every partition, counted
+ * from base, to starts.
+ */
+void partition_relation(JoinRelation in, JoinRelation out, int shift, int bits, size_t num_chunks, size_t base, size_t* starts) {
+    size_t num_partitions = (size_t)1 << bits;
+    size_t chunk_size = (in.length + num_chunks - 1) / num_chunks;
+    PartitionChunk* chunks = malloc(sizeof(PartitionChunk) * num_chunks);
+    for(size_t i = 0; i < num_chunks; i++) {
+        size_t first = i * chunk_size < in.length ? i * chunk_size : in.length;
+        chunks[i].in.values = in.values + first;
+        chunks[i].in.positions = in.positions + first;
+        chunks[i].in.length = in.length - first < chunk_size ? in.length - first : chunk_size;
+        chunks[i].out = out;
+        chunks[i].shift = shift;
+        chunks[i].bits = bits;
+    }
+    run_tasks_in_parallel(count_partition_chunk, chunks, sizeof(PartitionChunk), num_chunks, num_chunks);
+
+    // a partition's tuples from earlier chunks go before the ones from later chunks
+    size_t offset = 0;
+    for(size_t partition = 0; partition < num_partitions; partition++) {
+        starts[partition] = base + offset;
+        for(size_t i = 0; i < num_chunks; i++) {
+            size_t count = chunks[i].counts[partition];
+            chunks[i].counts[partition] = offset;
+            offset += count;
+        }
+    }
+    run_tasks_in_parallel(scatter_partition_chunk, chunks, sizeof(PartitionChunk), num_chunks, num_chunks);
+    free(chunks);
+}
+
+typedef struct PartitionTask {
+    JoinRelation in;
+    JoinRelation out;
+    int shift;
+    int bits;
+    size_t base;
+    size_t* starts;
+} PartitionTask;
+
+void* partition_task(void* args) {
+    PartitionTask* task = (PartitionTask*) args;
+    partition_relation(task->in, task->out, task->shift, task->bits, 1, task->base, task->starts);
+    return args;
+}
+
+static JoinRelation sub_relation(JoinRelation* relation, size_t first, size_t last) {
+    JoinRelation sub = {relation->values + first, relation->positions + first, last - first};
+    return sub;
+}
+
+/*
+ * radix_partition
+ * Partitions the relation into 2^total_bits partitions, at most JOIN_RADIX_BITS_PER_PASS bits per
+ * pass. The first pass splits the relation between the cores, the later ones partition every
+ * partition of the pass before as a task of its own. Returns the partitioned copy of the relation,
+ * partition i is at offsets[i] up to offsets[i + 1].
+ */
+JoinRelation radix_partition(JoinRelation* relation, int total_bits, size_t num_threads, size_t** offsets) {
+    size_t length = relation->length;
+    JoinRelation buffers[2];
+    for(size_t i = 0; i < 2; i++) {
+        buffers[i].values = malloc(sizeof(int) * (length > 0 ? length : 1));
+        buffers[i].positions = malloc(sizeof(int) * (length > 0 ? length : 1));
+        buffers[i].length = length;
+    }
+
+    JoinRelation current = *relation;
+    size_t num_partitions = 1;
+    size_t* partition_offsets = malloc(sizeof(size_t) * 2);
+    partition_offsets[0] = 0;
+    partition_offsets[1] = length;
+    int shift = 32;
+    for(int pass = 0, done = 0; done < total_bits; pass++) {
+        int bits = total_bits - done < JOIN_RADIX_BITS_PER_PASS ? total_bits - done : JOIN_RADIX_BITS_PER_PASS;
+        shift -= bits;
+        done += bits;
+        JoinRelation* out = &buffers[pass % 2];
+        size_t* new_offsets = malloc(sizeof(size_t) * ((num_partitions << bits) + 1));
+        if(num_partitions == 1) {
+            partition_relation(current, *out, shift, bits, num_threads, 0, new_offsets);
+        }
+        else {
+            PartitionTask* tasks = malloc(sizeof(PartitionTask) * num_partitions);
+            for(size_t i = 0; i < num_partitions; i++) {
+                tasks[i].in = sub_relation(&current, partition_offsets[i], partition_offsets[i + 1]);
+                tasks[i].out = sub_relation(out, partition_offsets[i], partition_offsets[i + 1]);
+                tasks[i].shift = shift;
+                tasks[i].bits = bits;
+                tasks[i].base = partition_offsets[i];
+                tasks[i].starts = new_offsets + (i << bits);
+            }
+            run_tasks_in_parallel(partition_task, tasks, sizeof(PartitionTask), num_partitions, num_threads);
+            free(tasks);
+        }
+        num_partitions <<= bits;
+        new_offsets[num_partitions] = length;
+        free(partition_offsets);
+        partition_offsets = new_offsets;
+        current = *out;
+    }
+
+    // the buffer the last pass did not write to is not needed anymore
+    size_t unused = current.values == buffers[0].values ? 1 : 0;
+    free(buffers[unused].values);
+    free(buffers[unused].positions);
+    *offsets = partition_offsets;
+    return current;
+}
+
+typedef struct JoinTask {
+    JoinRelation build;
+    JoinRelation probe;
+    // true when the build side is relation1, its positions then go to positions1
+    bool build_first;
+    // the size of the first buffer of matches
+    size_t expected_matches;
+    JoinMatches matches;
+} JoinTask;
+
+void* hash_join_task(void* args) {
+    JoinTask* task = (JoinTask*) args;
+    init_join_matches(&task->matches, task->expected_matches);
+    Hashmap* hashmap = hashmap_build(task->build.values, task->build.positions, task->build.length);
+    // every probe value matches all the positions its value has on the build side
+    for(size_t i = 0; i < task->probe.length; i++) {
+        int* matching_positions = NULL;
+        size_t num_matching = hashmap_get(hashmap, task->probe.values[i], &matching_positions);
+        for(size_t j = 0; j < num_matching; j++) {
+            if(task->build_first) {
+                add_join_match(&task->matches, matching_positions[j], task->probe.positions[i]);
+            }
+            else {
+                add_join_match(&task->matches, task->probe.positions[i], matching_positions[j]);
+            }
+        }
+    }
+    hashmap_free(hashmap);
+    return args;
+}
+
+// appends the matches of the tasks in task order
+static void append_task_matches(JoinMatches* matches, JoinTask* tasks, size_t num_tasks) {
+    for(size_t i = 0; i < num_tasks; i++) {
+        append_join_matches(matches, &tasks[i].matches);
+    }
+}
+
+void hash_join(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches) {
+    // the tables are built on the smaller relation so they stay as small as possible
+    bool build_first = relation1->length <= relation2->length;
+    JoinRelation* build = build_first ? relation1 : relation2;
+    JoinRelation* probe = build_first ? relation2 : relation1;
+
+    int total_bits = 0;
+    while(total_bits < JOIN_MAX_RADIX_BITS && (build->length >> total_bits) > JOIN_PARTITION_SIZE) {
+        total_bits++;
+    }
+    size_t num_threads = get_num_cores();
+    size_t num_partitions = (size_t)1 << total_bits;
+    JoinTask* tasks = malloc(sizeof(JoinTask) * num_partitions);
+    JoinRelation partitioned_build = *build;
+    JoinRelation partitioned_probe = *probe;
+    if(total_bits == 0) {
+        tasks[0].build = *build;
+        tasks[0].probe = *probe;
+    }
+    else {
+        size_t* build_offsets = NULL;
+        size_t* probe_offsets = NULL;
+        partitioned_build = radix_partition(build, total_bits, num_threads, &build_offsets);
+        partitioned_probe = radix_partition(probe, total_bits, num_threads, &probe_offsets);
+        for(size_t i = 0; i < num_partitions; i++) {
+            tasks[i].build = sub_relation(&partitioned_build, build_offsets[i], build_offsets[i + 1]);
+            tasks[i].probe = sub_relation(&partitioned_probe, probe_offsets[i], probe_offsets[i + 1]);
+        }
+        free(build_offsets);
+        free(probe_offsets);
+    }
+    for(size_t i = 0; i < num_partitions; i++) {
+        tasks[i].build_first = build_first;
+        tasks[i].expected_matches = (size_t)(matches->expected_per_tuple * tasks[i].probe.length);
+    }
+    run_tasks_in_parallel(hash_join_task, tasks, sizeof(JoinTask), num_partitions, num_threads);
+    append_task_matches(matches, tasks, num_partitions);
+    free(tasks);
+    if(total_bits > 0) {
+        free(partitioned_build.values);
+        free(partitioned_build.positions);
+        free(partitioned_probe.values);
+        free(partitioned_probe.positions);
+    }
+}
+
+// returns a copy of the relation sorted by value, equal values keep their order
+JoinRelation sort_relation(JoinRelation* relation) {
+    size_t length = relation->length;
+    uint64_t* keys = malloc(sizeof(uint64_t) * (length > 0 ? length : 1));
+    uint64_t* buffer = malloc(sizeof(uint64_t) * (length > 0 ? length : 1));
+    for(size_t i = 0; i < length; i++) {
+        keys[i] = key_with_position(relation->values[i], i);
+    }
+    uint64_t* sorted = parallel_radix_sort(keys, buffer, length, 32, 64);
+
+    JoinRelation sorted_relation;
+    sorted_relation.values = malloc(sizeof(int) * (length > 0 ? length : 1));
+    sorted_relation.positions = malloc(sizeof(int) * (length > 0 ? length : 1));
+    sorted_relation.length = length;
+    for(size_t i = 0; i < length; i++) {
+        sorted_relation.values[i] = key_of(sorted[i]);
+        sorted_relation.positions[i] = relation->positions[position_of(sorted[i])];
+    }
+    free(keys);
+    free(buffer);
+    return sorted_relation;
+}
+
+void sort_merge_join(JoinRelation* relation1, bool sorted1, JoinRelation* relation2, bool sorted2, JoinMatches* matches) {
+    JoinRelation left = sorted1 ? *relation1 : sort_relation(relation1);
+    JoinRelation right = sorted2 ? *relation2 : sort_relation(relation2);
+
+    size_t i = 0;
+    size_t j = 0;
+    while(i < left.length && j < right.length) {
+        if(left.values[i] < right.values[j]) {
+            i++;
+        }
+        else if(left.values[i] > right.values[j]) {
+            j++;
+        }
+        else {
+            // every tuple of the run of equal values on the left matches every one of the run on the right
+            int value = left.values[i];
+            size_t left_end = i + 1;
+            while(left_end < left.length && left.values[left_end] == value) {
+                left_end++;
+            }
+            size_t right_end = j + 1;
+            while(right_end < right.length && right.values[right_end] == value) {
+                right_end++;
+            }
+            for(size_t r = i; r < left_end; r++) {
+                for(size_t m = j; m < right_end; m++) {
+                    add_join_match(matches, left.positions[r], right.positions[m]);
+                }
+            }
+            i = left_end;
+            j = right_end;
+        }
+    }
+
+    if(!sorted1) {
+        free(left.values);
+        free(left.positions);
+    }
+    if(!sorted2) {
+        free(right.values);
+        free(right.positions);
+    }
+}
+
+static inline void add_task_match(JoinTask* task, int build_position, int probe_position) {
+    if(task->build_first) {
+        add_join_match(&task->matches, build_position, probe_position);
+    }
+    else {
+        add_join_match(&task->matches, probe_position, build_position);
+    }
+}
+
+// adds a match for every set bit of mask, bit i stands for the build value at first + i
+static inline void add_mask_matches(JoinTask* task, unsigned int mask, size_t first, int probe_position) {
+    while(mask != 0) {
+        add_task_match(task, task->build.positions[first + __builtin_ctz(mask)], probe_position);
+        mask &= mask - 1;
+    }
+}
+
+// compares one probe value against JOIN_NESTED_LOOP_LANES build values per step, the build tile
+// stays in L1 while the probe tile streams past it
+void* nested_loop_task(void* args) {
+    JoinTask* task = (JoinTask*) args;
+    init_join_matches(&task->matches, task->expected_matches);
+    int* build = task->build.values;
+    for(size_t j = 0; j < task->build.length; j += JOIN_NESTED_LOOP_TILE_SIZE) {
+        size_t tile_end = j + JOIN_NESTED_LOOP_TILE_SIZE < task->build.length ? j + JOIN_NESTED_LOOP_TILE_SIZE : task->build.length;
+        for(size_t r = 0; r < task->probe.length; r++) {
+            int value = task->probe.values[r];
+            int probe_position = task->probe.positions[r];
+            size_t m = j;
+#if defined(__SSE2__)
+            __m128i key = _mm_set1_epi32(value);
+            for(; m + JOIN_NESTED_LOOP_LANES <= tile_end; m += JOIN_NESTED_LOOP_LANES) {
+                __m128i equal0 = _mm_cmpeq_epi32(key, _mm_loadu_si128((__m128i*)(build + m)));
+                __m128i equal1 = _mm_cmpeq_epi32(key, _mm_loadu_si128((__m128i*)(build + m + 4)));
+                unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(equal0))
+                    | (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(equal1)) << 4;
+                add_mask_matches(task, mask, m, probe_position);
+            }
+#endif
+            for(; m < tile_end; m++) {
+                if(build[m] == value) {
+                    add_task_match(task, task->build.positions[m], probe_position);
+                }
+            }
+        }
+    }
+    return args;
+}
+
+void nested_loop_join(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches) {
+    // the smaller relation is compared against, the larger one is split into tiles that run in parallel
+    bool build_first = relation1->length <= relation2->length;
+    JoinRelation* build = build_first ? relation1 : relation2;
+    JoinRelation* probe = build_first ? relation2 : relation1;
+
+    size_t num_tiles = (probe->length + JOIN_NESTED_LOOP_TILE_SIZE - 1) / JOIN_NESTED_LOOP_TILE_SIZE;
+    if(num_tiles == 0) {
+        return;
+    }
+    JoinTask* tasks = malloc(sizeof(JoinTask) * num_tiles);
+    for(size_t i = 0; i < num_tiles; i++) {
+        size_t first = i * JOIN_NESTED_LOOP_TILE_SIZE;
+        size_t last = first + JOIN_NESTED_LOOP_TILE_SIZE < probe->length ? first + JOIN_NESTED_LOOP_TILE_SIZE : probe->length;
+        tasks[i].build = *build;
+        tasks[i].probe = sub_relation(probe, first, last);
+        tasks[i].build_first = build_first;
+        tasks[i].expected_matches = (size_t)(matches->expected_per_tuple * tasks[i].probe.length);
+    }
+    run_tasks_in_parallel(nested_loop_task, tasks, sizeof(JoinTask), num_tiles, get_num_cores());
+    append_task_matches(matches, tasks, num_tiles);
+    free(tasks);
+}
+
+// true when the select qualifies value
+static inline bool join_select_accepts(Comparator* select, int value) {
+    return (select->type1 == NO_COMPARISON || value >= select->p_low) &&
+           (select->type2 == NO_COMPARISON || value < select->p_high);
+}
+
+typedef struct IndexJoinTask {
+    JoinRelation probe;
+    Column* column;
+    Comparator* select;
+    // true when the select compares the indexed column, it is then checked on the probe values
+    // before they are looked up, otherwise on select_data for every row found
+    bool select_on_keys;
+    int* select_data;
+    bool probe_first;
+    size_t expected_matches;
+    JoinMatches matches;
+} IndexJoinTask;
+
+static inline void add_index_match(IndexJoinTask* task, int probe_position, int position) {
+    if(task->select_data != NULL && !join_select_accepts(task->select, task->select_data[position])) {
+        return;
+    }
+    if(task->probe_first) {
+        add_join_match(&task->matches, probe_position, position);
+    }
+    else {
+        add_join_match(&task->matches, position, probe_position);
+    }
+}
+
+void* index_join_task(void* args) {
+    IndexJoinTask* task = (IndexJoinTask*) args;
+    init_join_matches(&task->matches, task->expected_matches);
+    ColumnIndex* index = task->column->index;
+    size_t data_len = task->column->table->table_length;
+    int keys[JOIN_INDEX_BATCH_SIZE];
+    int probe_positions[JOIN_INDEX_BATCH_SIZE];
+    size_t firsts[JOIN_INDEX_BATCH_SIZE];
+    BtreeNode* leaves[JOIN_INDEX_BATCH_SIZE];
+    int slots[JOIN_INDEX_BATCH_SIZE];
+    size_t i = 0;
+    while(i < task->probe.length) {
+        size_t num_keys = 0;
+        for(; i < task->probe.length && num_keys < JOIN_INDEX_BATCH_SIZE; i++) {
+            if(task->select_on_keys && !join_select_accepts(task->select, task->probe.values[i])) {
+                continue;
+            }
+            keys[num_keys] = task->probe.values[i];
+            probe_positions[num_keys] = task->probe.positions[i];
+            num_keys++;
+        }
+        if(index->type == SORTED) {
+            SortedIndex* sorted_index = &index->index_fields.sorted_index;
+            sorted_index_lower_bounds(sorted_index, data_len, keys, num_keys, firsts);
+            for(size_t k = 0; k < num_keys; k++) {
+                for(size_t e = firsts[k]; e < data_len && sorted_index->data[e] == keys[k]; e++) {
+                    add_index_match(task, probe_positions[k], sorted_index->indices[e]);
+                }
+            }
+        }
+        else {
+            btree_lower_bounds(&index->index_fields.btree_index, keys, num_keys, leaves, slots);
+            for(size_t k = 0; k < num_keys; k++) {
+                // the rows of a value can continue in the next leaves
+                BtreeNode* leaf = leaves[k];
+                int slot = slots[k];
+                while(leaf != NULL) {
+                    if(slot == leaf->num_keys) {
+                        leaf = leaf->data.leaf_data.next_leaf;
+                        slot = 0;
+                    }
+                    else if(leaf->data.leaf_data.data[slot] == keys[k]) {
+                        add_index_match(task, probe_positions[k], leaf->data.leaf_data.indices[slot]);
+                        slot++;
+                    }
+                    else {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return args;
+}
+
+void index_nested_loop_join(JoinRelation* probe, Column* column, Comparator* select, bool probe_first, JoinMatches* matches) {
+    size_t num_tiles = (probe->length + JOIN_INDEX_TILE_SIZE - 1) / JOIN_INDEX_TILE_SIZE;
+    if(num_tiles == 0) {
+        return;
+    }
+    Column* select_column = select != NULL ? select->gen_col->column_pointer.column : NULL;
+    IndexJoinTask* tasks = malloc(sizeof(IndexJoinTask) * num_tiles);
+    for(size_t i = 0; i < num_tiles; i++) {
+        size_t first = i * JOIN_INDEX_TILE_SIZE;
+        size_t last = first + JOIN_INDEX_TILE_SIZE < probe->length ? first + JOIN_INDEX_TILE_SIZE : probe->length;
+        tasks[i].probe = sub_relation(probe, first, last);
+        tasks[i].column = column;
+        tasks[i].select = select;
+        tasks[i].select_on_keys = select_column == column;
+        tasks[i].select_data = select_column != NULL && select_column != column ? select_column->data : NULL;
+        tasks[i].probe_first = probe_first;
+        tasks[i].expected_matches = (size_t)(matches->expected_per_tuple * tasks[i].probe.length);
+    }
+    run_tasks_in_parallel(index_join_task, tasks, sizeof(IndexJoinTask), num_tiles, get_num_cores());
+    for(size_t i = 0; i < num_tiles; i++) {
+        append_join_matches(matches, &tasks[i].matches);
+    }
+    free(tasks);
+}
+
+// spill files of different joins get different names
+pthread_mutex_t spill_id_mutex = PTHREAD_MUTEX_INITIALIZER;
+size_t next_spill_id = 0;
+
+// the partition files of one relation, the tuples go through a buffer of value, position pairs
+typedef struct SpillPartition {
+    char path[MAX_SIZE_NAME + 64];
+    FILE* file;
+    int* buffer;
+    size_t buffered;
+    size_t length;
+} SpillPartition;
+
+static size_t hash_join_memory(size_t build_length) {
+    return build_length * JOIN_BYTES_PER_BUILD_TUPLE;
+}
+
+// every spill depth hashes with its own seed, so a partition spilled again splits up
+static inline size_t spill_partition_of(int value, int depth, size_t num_partitions) {
+    return murmurhash((const char*)&value, sizeof(int), (uint32_t)depth + 1) & (num_partitions - 1);
+}
+
+// returns false if the buffer did not make it to the file whole
+static bool flush_spill_partition(SpillPartition* partition) {
+    size_t written = fwrite(partition->buffer, sizeof(int) * 2, partition->buffered, partition->file);
+    bool complete = written == partition->buffered;
+    partition->length += partition->buffered;
+    partition->buffered = 0;
+    return complete;
+}
+
+static void remove_spill_partitions(SpillPartition* partitions, size_t num_partitions) {
+    for(size_t i = 0; i < num_partitions; i++) {
+        remove(partitions[i].path);
+    }
+}
+
+// writes the relation to one file per partition, returns false (and removes the files) if a file
+// cannot be opened, written or closed
+static bool spill_relation(JoinRelation* relation, int depth, size_t spill_id, int side, SpillPartition* partitions, size_t num_partitions) {
+    for(size_t i = 0; i < num_partitions; i++) {
+        snprintf(partitions[i].path, sizeof(partitions[i].path), "%s/join_spill.%zu.%d.%zu", JOIN_SPILL_DIRECTORY, spill_id, side, i);
+        partitions[i].file = fopen(partitions[i].path, "wb");
+        if(partitions[i].file == NULL) {
+            for(size_t j = 0; j < i; j++) {
+                fclose(partitions[j].file);
+                free(partitions[j].buffer);
+            }
+            remove_spill_partitions(partitions, i);
+            return false;
+        }
+        partitions[i].buffer = malloc(sizeof(int) * 2 * JOIN_SPILL_BUFFER_SIZE);
+        partitions[i].buffered = 0;
+        partitions[i].length = 0;
+    }
+    bool written = true;
+    for(size_t i = 0; i < relation->length && written; i++) {
+        SpillPartition* partition = &partitions[spill_partition_of(relation->values[i], depth, num_partitions)];
+        partition->buffer[2 * partition->buffered] = relation->values[i];
+        partition->buffer[2 * partition->buffered + 1] = relation->positions[i];
+        if(++partition->buffered == JOIN_SPILL_BUFFER_SIZE) {
+            written = flush_spill_partition(partition);
+        }
+    }
+    for(size_t i = 0; i < num_partitions; i++) {
+        written = written && flush_spill_partition(&partitions[i]);
+        // a full disk can also show up only when the stream is closed
+        written = fclose(partitions[i].file) == 0 && written;
+        free(partitions[i].buffer);
+    }
+    if(!written) {
+        remove_spill_partitions(partitions, num_partitions);
+    }
+    return written;
+}
+
+// reads a partition back into memory and removes its file. If the file cannot be read back whole,
+// the tuples of the partition are gathered again from the relation it was spilled from.
+static JoinRelation read_spill_partition(SpillPartition* partition, JoinRelation* source, int depth, size_t index, size_t num_partitions) {
+    JoinRelation relation;
+    relation.values = malloc(sizeof(int) * (partition->length > 0 ? partition->length : 1));
+    relation.positions = malloc(sizeof(int) * (partition->length > 0 ? partition->length : 1));
+    relation.length = 0;
+    FILE* file = fopen(partition->path, "rb");
+    if(file != NULL) {
+        int* buffer = malloc(sizeof(int) * 2 * JOIN_SPILL_BUFFER_SIZE);
+        size_t num_read;
+        while(relation.length < partition->length &&
+              (num_read = fread(buffer, sizeof(int) * 2, JOIN_SPILL_BUFFER_SIZE, file)) > 0) {
+            for(size_t i = 0; i < num_read && relation.length < partition->length; i++) {
+                relation.values[relation.length] = buffer[2 * i];
+                relation.positions[relation.length] = buffer[2 * i + 1];
+                relation.length++;
+            }
+        }
+        free(buffer);
+        fclose(file);
+    }
+    remove(partition->path);
+    if(relation.length < partition->length) {
+        cs165_log(stdout, "Could not read back join partition %zu, taking it from memory\n", index);
+        relation.length = 0;
+        for(size_t i = 0; i < source->length; i++) {
+            if(spill_partition_of(source->values[i], depth, num_partitions) == index) {
+                relation.values[relation.length] = source->values[i];
+                relation.positions[relation.length] = source->positions[i];
+                relation.length++;
+            }
+        }
+    }
+    return relation;
+}
+
+static void grace_hash_join_at_depth(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches, int depth) {
+    size_t memory = hash_join_memory(relation1->length < relation2->length ? relation1->length : relation2->length);
+    if(memory <= JOIN_MEMORY_BUDGET || depth == JOIN_MAX_SPILL_DEPTH) {
+        hash_join(relation1, relation2, matches);
+        return;
+    }
+    // twice the partitions the budget asks for leaves room for uneven partitions
+    size_t num_partitions = 2;
+    while(num_partitions < JOIN_MAX_SPILL_PARTITIONS && num_partitions * JOIN_MEMORY_BUDGET < 2 * memory) {
+        num_partitions *= 2;
+    }
+    pthread_mutex_lock(&spill_id_mutex);
+    size_t spill_id = next_spill_id++;
+    pthread_mutex_unlock(&spill_id_mutex);
+
+    mkdir(JOIN_SPILL_DIRECTORY, 0777);
+    SpillPartition partitions1[num_partitions];
+    SpillPartition partitions2[num_partitions];
+    if(!spill_relation(relation1, depth, spill_id, 1, partitions1, num_partitions)) {
+        cs165_log(stdout, "Could not write the join spill files, joining in memory\n");
+        hash_join(relation1, relation2, matches);
+        return;
+    }
+    if(!spill_relation(relation2, depth, spill_id, 2, partitions2, num_partitions)) {
+        remove_spill_partitions(partitions1, num_partitions);
+        cs165_log(stdout, "Could not write the join spill files, joining in memory\n");
+        hash_join(relation1, relation2, matches);
+        return;
+    }
+    cs165_log(stdout, "Spilled %zu and %zu tuples into %zu join partitions\n", relation1->length, relation2->length, num_partitions);
+
+    // equal values land in partitions of the same number, only one pair is in memory at a time
+    for(size_t i = 0; i < num_partitions; i++) {
+        JoinRelation partition1 = read_spill_partition(&partitions1[i], relation1, depth, i, num_partitions);
+        JoinRelation partition2 = read_spill_partition(&partitions2[i], relation2, depth, i, num_partitions);
+        if(partition1.length > 0 && partition2.length > 0) {
+            grace_hash_join_at_depth(&partition1, &partition2, matches, depth + 1);
+        }
+        free(partition1.values);
+        free(partition1.positions);
+        free(partition2.values);
+        free(partition2.positions);
+    }
+}
+
+void grace_hash_join(JoinRelation* relation1, JoinRelation* relation2, JoinMatches* matches) {
+    grace_hash_join_at_depth(relation1, relation2, matches, 0);
+}
+
+typedef struct MultiJoinTask {
+    int* fact_positions;
+    int** fact_keys;
+    Hashmap** tables;
+    size_t num_dimensions;
+    // the fact tuples of the task
+    size_t first;
+    size_t last;
+    int* outputs[MULTI_JOIN_MAX_DIMENSIONS + 1];
+    size_t num_matches;
+    size_t capacity;
+} MultiJoinTask;
+
+static void add_multi_join_match(MultiJoinTask* task, int fact_position, int* dimension_positions) {
+    if(task->num_matches == task->capacity) {
+        task->capacity *= 2;
+        for(size_t d = 0; d <= task->num_dimensions; d++) {
+            task->outputs[d] = realloc(task->outputs[d], sizeof(int) * task->capacity);
+        }
+    }
+    task->outputs[0][task->num_matches] = fact_position;
+    for(size_t d = 0; d < task->num_dimensions; d++) {
+        task->outputs[d + 1][task->num_matches] = dimension_positions[d];
+    }
+    task->num_matches++;
+}
+
+void* multi_join_task(void* args) {
+    MultiJoinTask* task = (MultiJoinTask*) args;
+    size_t num_dimensions = task->num_dimensions;
+    task->capacity = task->last - task->first > 0 ? task->last - task->first : 1;
+    task->num_matches = 0;
+    for(size_t d = 0; d <= num_dimensions; d++) {
+        task->outputs[d] = malloc(sizeof(int) * task->capacity);
+    }
+    // the fact tuples of the vector still matching, and where their matches in every dimension are
+    size_t selected[MULTI_JOIN_VECTOR_SIZE];
+    int** matches = malloc(sizeof(int*) * num_dimensions * MULTI_JOIN_VECTOR_SIZE);
+    size_t* num_matches = malloc(sizeof(size_t) * num_dimensions * MULTI_JOIN_VECTOR_SIZE);
+
+    for(size_t first = task->first; first < task->last; first += MULTI_JOIN_VECTOR_SIZE) {
+        size_t num_selected = task->last - first < MULTI_JOIN_VECTOR_SIZE ? task->last - first : MULTI_JOIN_VECTOR_SIZE;
+        for(size_t i = 0; i < num_selected; i++) {
+            selected[i] = first + i;
+        }
+        for(size_t d = 0; d < num_dimensions && num_selected > 0; d++) {
+            int* keys = task->fact_keys[d];
+            size_t kept = 0;
+            for(size_t i = 0; i < num_selected; i++) {
+                int* positions = NULL;
+                size_t count = hashmap_get(task->tables[d], keys[selected[i]], &positions);
+                if(count == 0) {
+                    continue;
+                }
+                selected[kept] = selected[i];
+                for(size_t e = 0; e < d; e++) {
+                    matches[e * MULTI_JOIN_VECTOR_SIZE + kept] = matches[e * MULTI_JOIN_VECTOR_SIZE + i];
+                    num_matches[e * MULTI_JOIN_VECTOR_SIZE + kept] = num_matches[e * MULTI_JOIN_VECTOR_SIZE + i];
+                }
+                matches[d * MULTI_JOIN_VECTOR_SIZE + kept] = positions;
+                num_matches[d * MULTI_JOIN_VECTOR_SIZE + kept] = count;
+                kept++;
+            }
+            num_selected = kept;
+        }
+
+        // every combination of the matches of a fact tuple is a result, one per tuple with unique keys
+        for(size_t i = 0; i < num_selected; i++) {
+            size_t indexes[MULTI_JOIN_MAX_DIMENSIONS] = {0};
+            int dimension_positions[MULTI_JOIN_MAX_DIMENSIONS];
+            bool done = false;
+            while(!done) {
+                for(size_t d = 0; d < num_dimensions; d++) {
+                    dimension_positions[d] = matches[d * MULTI_JOIN_VECTOR_SIZE + i][indexes[d]];
+                }
+                add_multi_join_match(task, task->fact_positions[selected[i]], dimension_positions);
+                done = true;
+                for(size_t d = num_dimensions; d > 0 && done; d--) {
+                    if(++indexes[d - 1] < num_matches[(d - 1) * MULTI_JOIN_VECTOR_SIZE + i]) {
+                        done = false;
+                    }
+                    else {
+                        indexes[d - 1] = 0;
+                    }
+                }
+            }
+        }
+    }
+    free(matches);
+    free(num_matches);
+    return args;
+}
+
+size_t multi_join(int* fact_positions, int** fact_keys, size_t num_facts, JoinRelation* dimensions, size_t num_dimensions, int** outputs) {
+    Hashmap* tables[MULTI_JOIN_MAX_DIMENSIONS];
+    for(size_t d = 0; d < num_dimensions; d++) {
+        tables[d] = hashmap_build(dimensions[d].values, dimensions[d].positions, dimensions[d].length);
+    }
+    size_t num_tasks = (num_facts + MULTI_JOIN_CHUNK_SIZE - 1) / MULTI_JOIN_CHUNK_SIZE;
+    num_tasks = num_tasks > 0 ? num_tasks : 1;
+    MultiJoinTask* tasks = malloc(sizeof(MultiJoinTask) * num_tasks);
+    for(size_t i = 0; i < num_tasks; i++) {
+        tasks[i].fact_positions = fact_positions;
+        tasks[i].fact_keys = fact_keys;
+        tasks[i].tables = tables;
+        tasks[i].num_dimensions = num_dimensions;
+        tasks[i].first = i * MULTI_JOIN_CHUNK_SIZE < num_facts ? i * MULTI_JOIN_CHUNK_SIZE : num_facts;
+        tasks[i].last = tasks[i].first + MULTI_JOIN_CHUNK_SIZE < num_facts ? tasks[i].first + MULTI_JOIN_CHUNK_SIZE : num_facts;
+    }
+    run_tasks_in_parallel(multi_join_task, tasks, sizeof(MultiJoinTask), num_tasks, get_num_cores());
+
+    // the matches of the tasks in task order, so they follow the order of the fact tuples
+    size_t total = 0;
+    for(size_t i = 0; i < num_tasks; i++) {
+        total += tasks[i].num_matches;
+    }
+    for(size_t d = 0; d <= num_dimensions; d++) {
+        outputs[d] = malloc(sizeof(int) * (total > 0 ? total : 1));
+        size_t offset = 0;
+        for(size_t i = 0; i < num_tasks; i++) {
+            memcpy(outputs[d] + offset, tasks[i].outputs[d], sizeof(int) * tasks[i].num_matches);
+            offset += tasks[i].num_matches;
+            free(tasks[i].outputs[d]);
+        }
+    }
+    free(tasks);
+    for(size_t d = 0; d < num_dimensions; d++) {
+        hashmap_free(tables[d]);
+    }
+    return total;
+}
+
+void execute_multi_join(DbOperator* query) {
+    MultiJoinOperator* multi = &query->operator_fields.multi_join_operator;
+    int* fact_keys[MULTI_JOIN_MAX_DIMENSIONS];
+    JoinRelation dimensions[MULTI_JOIN_MAX_DIMENSIONS];
+    for(size_t d = 0; d < multi->num_dimensions; d++) {
+        fact_keys[d] = (int*)multi->fact_keys[d]->payload;
+        dimensions[d].values = (int*)multi->dimension_values[d]->payload;
+        dimensions[d].positions = (int*)multi->dimension_positions[d]->payload;
+        dimensions[d].length = multi->dimension_values[d]->num_tuples;
+    }
+    int* outputs[MULTI_JOIN_MAX_DIMENSIONS + 1];
+    size_t num_matches = multi_join((int*)multi->fact_positions->payload, fact_keys, multi->fact_positions->num_tuples,
+                                    dimensions, multi->num_dimensions, outputs);
+    for(size_t d = 0; d <= multi->num_dimensions; d++) {
+        Result* result = init_result();
+        result->payload = outputs[d];
+        result->num_tuples = num_matches;
+        // the fact positions keep the order of the fact tuples
+        result->sorted = d == 0 && multi->fact_positions->sorted;
+        add_result_to_context(query->context, multi->handles[d], result);
+    }
+}
+
+// few enough pairs, or a small enough side to compare the other one against, are compared
+// directly, sorted inputs merge without any table and the rest is hashed, through spill files
+// when the table does not fit the memory budget
+JoinType choose_join_type(size_t length1, bool sorted1, size_t length2, bool sorted2) {
+    size_t smaller = length1 < length2 ? length1 : length2;
+    if(smaller <= JOIN_NESTED_LOOP_MAX_SMALL_SIDE || length1 <= JOIN_NESTED_LOOP_MAX_PAIRS / length2) {
+        return NESTED;
+    }
+    if(sorted1 && sorted2) {
+        return SORT_MERGE;
+    }
+    return hash_join_memory(smaller) > JOIN_MEMORY_BUDGET ? GRACE : HASH;
+}
+
+// appends the positions whose value passes the filter, together with the value, to the relation
+static void filter_join_positions(JoinRelation* relation, size_t* capacity, int* positions, size_t num_positions,
+                                  Column* fetch_column, BloomFilter* filter) {
+    if(relation->length + num_positions > *capacity) {
+        *capacity = 2 * *capacity > relation->length + num_positions ? 2 * *capacity : relation->length + num_positions;
+        relation->values = realloc(relation->values, sizeof(int) * *capacity);
+        relation->positions = realloc(relation->positions, sizeof(int) * *capacity);
+    }
+    for(size_t i = 0; i < num_positions; i++) {
+        int value = fetch_column->data[positions[i]];
+        if(bloom_filter_may_contain(filter, value)) {
+            relation->values[relation->length] = value;
+            relation->positions[relation->length] = positions[i];
+            relation->length++;
+        }
+    }
+}
+
+// scans a join side given as fetch(col,select(...)) one vector at a time. Only the rows whose
+// value passes the filter of the other side are fetched into the relation.
+JoinRelation scan_join_side(Comparator* select, Column* fetch_column, JoinRelation* other) {
+    BloomFilter* filter = create_bloom_filter(other->length);
+    bloom_filter_add_values(filter, other->values, other->length);
+
+    JoinRelation relation;
+    size_t capacity = SELECT_VECTOR_SIZE;
+    relation.values = malloc(sizeof(int) * capacity);
+    relation.positions = malloc(sizeof(int) * capacity);
+    relation.length = 0;
+    size_t num_selected = 0;
+    GeneralizedColumn* col_vec = select->gen_col;
+    if(select->vec_pos == NULL && col_vec->column_type == COLUMN && col_vec->column_pointer.column->index != NULL) {
+        // the index hands out the positions in index order, there is no scan to chunk
+        Column* column = col_vec->column_pointer.column;
+        Result* positions = init_result();
+        positions->payload = malloc(sizeof(int) * (column->table->table_length > 0 ? column->table->table_length : 1));
+        select_from_index(column->index, select, positions, column->table->table_length);
+        num_selected = positions->num_tuples;
+        filter_join_positions(&relation, &capacity, positions->payload, positions->num_tuples, fetch_column, filter);
+        free_result(positions);
+    }
+    else {
+        int vector_positions[SELECT_VECTOR_SIZE];
+        Result positions;
+        positions.payload = vector_positions;
+        size_t data_length = get_comparator_data_length(select);
+        for(size_t cur_loc = 0; cur_loc < data_length; cur_loc += SELECT_VECTOR_SIZE) {
+            select_vector(select, cur_loc, &positions);
+            num_selected += positions.num_tuples;
+            filter_join_positions(&relation, &capacity, vector_positions, positions.num_tuples, fetch_column, filter);
+        }
+    }
+    free_bloom_filter(filter);
+    cs165_log(stdout, "Join filter kept %zu of %zu selected rows\n", relation.length, num_selected);
+    return relation;
+}
+
+// the side of the join that is looked up in the index of its fetched column in place of being
+// scanned, 0 when no index is used
+static int choose_index_join_side(JoinOperator* join, JoinRelation* relation1, JoinRelation* relation2) {
+    if(join->type != INDEX && join->type != AUTO) {
+        return 0;
+    }
+    int side = join->select1 != NULL ? 1 : (join->select2 != NULL ? 2 : 0);
+    Comparator* select = side == 1 ? join->select1 : join->select2;
+    Column* column = side == 1 ? join->fetch_col1 : join->fetch_col2;
+    // the select is checked for the rows the lookups find, so it has to compare a column of the table
+    if(side == 0 || column->index == NULL || select->vec_pos != NULL || select->gen_col->column_type != COLUMN ||
+       select->gen_col->column_pointer.column->table != column->table) {
+        if(join->type == INDEX) {
+            cs165_log(stdout, "No side of the join can be looked up in an index, picking the join type\n");
+        }
+        return 0;
+    }
+    JoinRelation* probe = side == 1 ? relation2 : relation1;
+    if(join->type == AUTO && probe->length * JOIN_INDEX_PROBE_RATIO > column->table->table_length) {
+        return 0;
+    }
+    return side;
+}
+
+// joins the relations with the join type of the operator, or the one chosen for them, after
+// scanning the side given as fetch(col,select(...)) if there is one
+static void join_relations(JoinOperator* join, JoinRelation* relation1, bool sorted1, JoinRelation* relation2, bool sorted2,
+                           JoinMatches* matches) {
+    if(join->select1 != NULL) {
+        *relation1 = scan_join_side(join->select1, join->fetch_col1, relation2);
+    }
+    if(join->select2 != NULL) {
+        *relation2 = scan_join_side(join->select2, join->fetch_col2, relation1);
+    }
+    JoinType type = join->type;
+    if(type == AUTO || type == INDEX) {
+        type = choose_join_type(relation1->length, sorted1, relation2->length, sorted2);
+    }
+    // the estimate sizes the buffers of the matches, so selective joins do not reserve a match per
+    // tuple and one-to-many joins do not grow their buffers over and over. Only the sort-merge join
+    // adds to matches directly, the others append the buffers of their tasks.
+    size_t larger_length = relation1->length > relation2->length ? relation1->length : relation2->length;
+    size_t expected_matches = estimate_join_matches(relation1, relation2);
+    init_join_matches(matches, type == SORT_MERGE ? expected_matches : 0);
+    matches->expected_per_tuple = larger_length > 0 ? (double)expected_matches / larger_length : 0;
+    switch(type) {
+        case HASH:
+            hash_join(relation1, relation2, matches);
+            break;
+        case NESTED:
+            nested_loop_join(relation1, relation2, matches);
+            break;
+        case SORT_MERGE:
+            sort_merge_join(relation1, sorted1, relation2, sorted2, matches);
+            break;
+        case GRACE:
+            grace_hash_join(relation1, relation2, matches);
+            break;
+        case INDEX:
+        case AUTO:
+            break;
+    }
+    cs165_log(stdout, "Join estimated %zu matches, found %zu\n", expected_matches, count_join_matches(matches));
+    JoinRelation* scanned = join->select1 != NULL ? relation1 : (join->select2 != NULL ? relation2 : NULL);
+    if(scanned != NULL) {
+        free(scanned->values);
+        free(scanned->positions);
+    }
+}
+
+void execute_join(DbOperator* query) {
+    ClientContext* context = query->context;
+    JoinOperator join = query->operator_fields.join_operator;
+    JoinRelation relation1;
+    JoinRelation relation2;
+    bool sorted1 = false;
+    bool sorted2 = false;
+    if(join.select1 == NULL) {
+        relation1 = (JoinRelation){(int*)join.val_vec1->payload, (int*)join.pos_vec1->payload, join.val_vec1->num_tuples};
+        sorted1 = join.val_vec1->sorted;
+    }
+    if(join.select2 == NULL) {
+        relation2 = (JoinRelation){(int*)join.val_vec2->payload, (int*)join.pos_vec2->payload, join.val_vec2->num_tuples};
+        sorted2 = join.val_vec2->sorted;
+    }
+    JoinMatches matches;
+    int index_side = choose_index_join_side(&join, &relation1, &relation2);
+    if(index_side != 0) {
+        // the indexed side is never scanned, the values of the other side are looked up in its index
+        JoinRelation* probe = index_side == 1 ? &relation2 : &relation1;
+        Column* column = index_side == 1 ? join.fetch_col1 : join.fetch_col2;
+        init_join_matches(&matches, 0);
+        index_nested_loop_join(probe, column, index_side == 1 ? join.select1 : join.select2, index_side == 2, &matches);
+        cs165_log(stdout, "Looked up %zu values in the index of %s, found %zu matches\n", probe->length, column->name,
+                  count_join_matches(&matches));
+    }
+    else {
+        join_relations(&join, &relation1, sorted1, &relation2, sorted2, &matches);
+    }
+    collect_join_matches(&matches);
+    if(join.sorted) {
+        sort_join_matches(&matches);
+    }
+
+    Result* result1 = init_result();
+    result1->payload = matches.positions1;
+    result1->num_tuples = matches.num_matches;
+    result1->sorted = join.sorted;
+    Result* result2 = init_result();
+    result2->payload = matches.positions2;
+    result2->num_tuples = matches.num_matches;
+    add_result_to_context(context, join.handle1, result1);
+    add_result_to_context(context, join.handle2, result2);
+}
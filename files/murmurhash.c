@@ -49,8 +49,8 @@ uint32_t murmurhash (const char *key, uint32_t len, uint32_t seed) {
 
     // remainder
     switch (len & 3) { // `len % 4'
-        case 3: k ^= (tail[2] << 16);
-        case 2: k ^= (tail[1] << 8);
+        case 3: k ^= (tail[2] << 16); // fall through
+        case 2: k ^= (tail[1] << 8); // fall through
         case 1:
             k ^= tail[0];
             k *= c1;
@@ -69,3 +69,16 @@ uint32_t murmurhash (const char *key, uint32_t len, uint32_t seed) {
 
     return h;
 }
+
+uint32_t murmurhash_int (int key) {
+    // the finalizer of MurmurHash3 on its own mixes every bit of a 4 byte key into every bit of the hash
+    uint32_t h = (uint32_t) key;
+
+    h ^= (h >> 16);
+    h *= 0x85ebca6b;
+    h ^= (h >> 13);
+    h *= 0xc2b2ae35;
+    h ^= (h >> 16);
+
+    return h;
+}
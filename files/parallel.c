@@ -0,0 +1,66 @@
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "include/parallel.h"
+
+typedef struct TaskQueue {
+    void* (*routine)(void*);
+    char* args;
+    size_t arg_size;
+    size_t num_tasks;
+    size_t next_task;
+    pthread_mutex_t mutex;
+} TaskQueue;
+
+size_t get_num_cores() {
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(num_cores < 1) {
+        return 1;
+    }
+    return (size_t)num_cores;
+}
+
+void* run_queued_tasks(void* arg) {
+    TaskQueue* queue = (TaskQueue*) arg;
+    while(true) {
+        pthread_mutex_lock(&queue->mutex);
+        size_t task = queue->next_task++;
+        pthread_mutex_unlock(&queue->mutex);
+        if(task >= queue->num_tasks) {
+            break;
+        }
+        queue->routine(queue->args + task * queue->arg_size);
+    }
+    return NULL;
+}
+
+void run_tasks_in_parallel(void* (*routine)(void*), void* args, size_t arg_size, size_t num_tasks, size_t num_threads) {
+    if(num_threads > num_tasks) {
+        num_threads = num_tasks;
+    }
+    if(num_threads <= 1) {
+        for(size_t i = 0; i < num_tasks; i++) {
+            routine((char*)args + i * arg_size);
+        }
+        return;
+    }
+
+    TaskQueue queue;
+    queue.routine = routine;
+    queue.args = (char*)args;
+    queue.arg_size = arg_size;
+    queue.num_tasks = num_tasks;
+    queue.next_task = 0;
+    pthread_mutex_init(&queue.mutex, NULL);
+
+    pthread_t threads[num_threads];
+    for(size_t i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, run_queued_tasks, (void*)&queue);
+    }
+    for(size_t i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.mutex);
+}
@@ -82,6 +82,25 @@ GeneralizedColumn* find_vec_by_name(char* name, ClientContext* context, bool loo
     return NULL;
 }
 
+// returns true if both generalized columns point to the same column or result (or are both missing)
+bool same_generalized_column(GeneralizedColumn* col1, GeneralizedColumn* col2) {
+    if(col1 == NULL || col2 == NULL) {
+        return col1 == col2;
+    }
+    if(col1->column_type != col2->column_type) {
+        return false;
+    }
+    if(col1->column_type == COLUMN) {
+        return col1->column_pointer.column == col2->column_pointer.column;
+    }
+    return col1->column_pointer.result == col2->column_pointer.result;
+}
+
+// selects, fetches and joins read their inputs as ints, only the aggregates take the LONG results of add and sub
+bool is_int_vector(GeneralizedColumn* col) {
+    return col->column_type == COLUMN || col->column_pointer.result->data_type == INT;
+}
+
 /**
  * This method takes in a string representing the arguments to create a table.
  * It parses those arguments, checks that they are valid, and creates a table.
@@ -231,6 +250,19 @@ message_status parse_create_index(char* create_arguments) {
 
     char* full_column_name = next_token(&create_arguments, &status);
     char* index_type = next_token(&create_arguments, &status);
+
+    // prefix sums sit next to any index of the column, they take no clustering argument
+    if(status != INCORRECT_FORMAT && strcmp(index_type, "prefix_sum") == 0) {
+        Column* col = lookup_column(full_column_name);
+        if(col == NULL) {
+           return OBJECT_NOT_FOUND; 
+        }
+        if(col->prefix_sum == NULL) {
+            col->prefix_sum = create_prefix_sum();
+        }
+        return OK_DONE;
+    }
+
     char* index_clustered = next_token(&create_arguments, &status);
         
     if (status == INCORRECT_FORMAT) {
@@ -340,70 +372,78 @@ DbOperator* parse_print(char* query_command, message* send_message, ClientContex
     return dbo;
 }
 
-DbOperator* parse_fetch(char* query_command, message* send_message, char* handle, ClientContext* context) {
-    // check for leading '('
-    if (strncmp(query_command, "(", 1) == 0) {
-        query_command++;
+// looks up a db.tbl.col column name, returns NULL if the table or the column doesn't exist
+Column* lookup_full_column_name(char* full_column_name) {
+    strsep(&full_column_name, ".");
+    char* table_name = strsep(&full_column_name, ".");
+    char* column_name = full_column_name;
+    if(table_name == NULL || column_name == NULL) {
+        return NULL;
+    }
+    Table* table = lookup_table(table_name);
+    if(table == NULL) {
+        return NULL;
+    }
+    return lookup_column_in_table(table, column_name);
+}
 
-        char** command_index = &query_command;
-        char* full_column_name = next_token(command_index, &send_message->status);
-        strsep(&full_column_name, ".");
-        char* table_name = strsep(&full_column_name, ".");
-        char* column_name = full_column_name;
-        char* vector_name = next_token(command_index, &send_message->status);
-        
-        if (send_message->status == INCORRECT_FORMAT) {
-            return NULL;
-        }
-        
-        // read and chop off last char, which should be a ')'
-        int last_char = strlen(vector_name) - 1;
-        if (vector_name[last_char] != ')') {
-           send_message->status = INCORRECT_FORMAT;
-        }
-        // replace the ')' with a null terminating character. 
-        vector_name[last_char] = '\0';
+// parses fetch(col,pos) or, for several handles a,b=fetch(col_a,col_b,pos), a fetch of many 
+// columns through the same positions
+DbOperator* parse_fetch(char* query_command, message* send_message, char* handle, ClientContext* context) {
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+    size_t num_cols = count_num_arguments(query_command) - 1;
+    if(num_cols == 0 || handle == NULL || (size_t)count_num_arguments(handle) != num_cols) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
 
-        Table* select_table = lookup_table(table_name);
-        if (select_table == NULL) {
-            send_message->status = OBJECT_NOT_FOUND;
-            return NULL;
-        }
-        Column* select_column = lookup_column_in_table(select_table, column_name);
-        if(select_column == NULL) {
+    char** command_index = &query_command;
+    Column* columns[num_cols];
+    for(size_t i = 0; i < num_cols; i++) {
+        columns[i] = lookup_full_column_name(next_token(command_index, &send_message->status));
+        if(columns[i] == NULL) {
             send_message->status = OBJECT_NOT_FOUND; 
             return NULL;
         }
-        Result* pos_vec = lookup_vec(context, vector_name); 
-        if(pos_vec == NULL) {
-            send_message->status = OBJECT_NOT_FOUND; 
-            return NULL; 
-        }
-
-        DbOperator* dbo = malloc(sizeof(DbOperator));
-        dbo->type = FETCH;
-        dbo->context = context; 
-
-        GeneralizedColumn* col1 = malloc(sizeof(GeneralizedColumn));
-        col1->column_type = COLUMN; 
-        col1->column_pointer.column = select_column; 
-        dbo->operator_fields.fetch_operator.col1 = col1;
-
-        GeneralizedColumn* col2 = malloc(sizeof(GeneralizedColumn));
-        col2->column_type = RESULT;
-        col2->column_pointer.result = pos_vec; 
-        dbo->operator_fields.fetch_operator.col2 = col2; 
-        
-        strcpy(dbo->operator_fields.fetch_operator.handle, handle); 
-        return dbo;
+    }
+    char* vector_name = next_token(command_index, &send_message->status);
+    Result* pos_vec = lookup_vec(context, vector_name); 
+    if(pos_vec == NULL) {
+        send_message->status = OBJECT_NOT_FOUND; 
+        return NULL; 
+    }
+    if(pos_vec->data_type != INT) {
+        send_message->status = INCORRECT_FORMAT; 
+        return NULL; 
+    }
 
-    } else {
-        send_message->status = UNKNOWN_COMMAND;
-        return NULL;
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->type = FETCH;
+    dbo->context = context; 
+    FetchOperator* fetch_operator = &dbo->operator_fields.fetch_operator;
+    fetch_operator->num_cols = num_cols;
+    fetch_operator->cols = malloc(sizeof(GeneralizedColumn*) * num_cols);
+    fetch_operator->handles = malloc(sizeof(char*) * num_cols);
+    for(size_t i = 0; i < num_cols; i++) {
+        fetch_operator->cols[i] = malloc(sizeof(GeneralizedColumn));
+        fetch_operator->cols[i]->column_type = COLUMN; 
+        fetch_operator->cols[i]->column_pointer.column = columns[i]; 
+        char* cur_handle = strsep(&handle, ",");
+        fetch_operator->handles[i] = malloc(strlen(cur_handle) + 1);
+        strcpy(fetch_operator->handles[i], cur_handle); 
     }
+
+    fetch_operator->pos_vec = malloc(sizeof(GeneralizedColumn));
+    fetch_operator->pos_vec->column_type = RESULT;
+    fetch_operator->pos_vec->column_pointer.result = pos_vec; 
+    return dbo;
 }
 
-DbOperator* parse_select(char* query_command, message* send_message, char* handle, ClientContext* context, DbOperator* operator) {
+// parses the arguments of a select, (col,low,high) or (pos_vec,vals,low,high), into a comparator
+Comparator* parse_comparator(char* query_command, message* send_message, char* handle, ClientContext* context) {
     parse_open_close_parenthesis(&query_command, &send_message->status); 
     if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
         return NULL;
@@ -448,11 +488,21 @@ DbOperator* parse_select(char* query_command, message* send_message, char* handl
         }
         col2 = find_vec_by_name(full_column_name, context, false); 
         if(col2 == NULL) {
-            free(col2);
+            free(col1);
             send_message->status = OBJECT_NOT_FOUND; 
             return NULL;
         }
     }
+    else {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    if(!is_int_vector(col1) || (col2 != NULL && !is_int_vector(col2))) {
+        free(col1);
+        free(col2);
+        send_message->status = INCORRECT_FORMAT; 
+        return NULL;
+    }
 
     Comparator* comparator = malloc(sizeof(Comparator));
 
@@ -483,6 +533,14 @@ DbOperator* parse_select(char* query_command, message* send_message, char* handl
         comparator->vec_pos = col1;
     }
     strcpy(comparator->handle, handle);
+    return comparator;
+}
+
+DbOperator* parse_select(char* query_command, message* send_message, char* handle, ClientContext* context, DbOperator* operator) {
+    Comparator* comparator = parse_comparator(query_command, send_message, handle, context);
+    if(comparator == NULL) {
+        return NULL;
+    }
 
     DbOperator* dbo = NULL;
 
@@ -498,21 +556,32 @@ DbOperator* parse_select(char* query_command, message* send_message, char* handl
     }
     else {
         BatchOperator* batch_operator = &operator->operator_fields.batch_operator; 
-        if(batch_operator->selects_length > 0 &&
-           batch_operator->selects[batch_operator->selects_length - 1]->comparators_length < 
-           batch_operator->selects[batch_operator->selects_length - 1]->comparators_capacity) {
-            // in this case the last select operator can still hold more 
-            // comparators for the shared scan
-            SelectOperator* last_select = batch_operator->selects[batch_operator->selects_length - 1];
-            last_select->comparators[last_select->comparators_length++] = comparator; 
+        // look for a select operator in the batch that scans the same column (and position vector),
+        // all the comparators on the same input are answered by a shared scan
+        SelectOperator* shared_select = NULL;
+        for(size_t i = 0; i < batch_operator->selects_length; i++) {
+            Comparator* first_comparator = batch_operator->selects[i]->comparators[0];
+            if(same_generalized_column(first_comparator->gen_col, comparator->gen_col) &&
+               same_generalized_column(first_comparator->vec_pos, comparator->vec_pos)) {
+                shared_select = batch_operator->selects[i];
+                break;
+            }
+        }
+        if(shared_select != NULL) {
+            if(shared_select->comparators_length == shared_select->comparators_capacity) {
+                shared_select->comparators_capacity *= 2;
+                shared_select->comparators = realloc(shared_select->comparators, 
+                                                     sizeof(Comparator*) * shared_select->comparators_capacity);
+            }
+            shared_select->comparators[shared_select->comparators_length++] = comparator; 
         }
         // in this case we need to create a new select operator to insert to batch 
         else {
             SelectOperator* new_select = malloc(sizeof(SelectOperator));
-            new_select->comparators = malloc(sizeof(Comparator*) * DEFAULT_MAX_SHARED_SCANS);
+            new_select->comparators = malloc(sizeof(Comparator*) * DEFAULT_SHARED_SCAN_CAPACITY);
             new_select->comparators[0] = comparator;
             new_select->comparators_length = 1; 
-            new_select->comparators_capacity = DEFAULT_MAX_SHARED_SCANS;
+            new_select->comparators_capacity = DEFAULT_SHARED_SCAN_CAPACITY;
             batch_operator->selects[batch_operator->selects_length++] = new_select;
         }
     }
@@ -619,12 +688,58 @@ DbOperator* parse_sub_add(char* query_command, message* send_message, char* hand
     return dbo;
 }
 
+// parses fetch(col,select(...)) into the comparator of the select and the fetched column
+Comparator* parse_fetch_of_select(char* query_command, message* send_message, char* handle, ClientContext* context, Column** fetch_column) {
+    query_command += 5;
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+
+    char* full_column_name = strsep(&query_command, ",");
+    if(query_command == NULL || strncmp(query_command, "select", 6) != 0) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    *fetch_column = lookup_full_column_name(full_column_name);
+    if(*fetch_column == NULL) {
+        send_message->status = OBJECT_NOT_FOUND; 
+        return NULL;
+    }
+    return parse_comparator(query_command + 6, send_message, handle, context);
+}
+
+// parses an aggregate over fetch(col,select(...)) into a pipeline operator, so the select and the
+// fetch never materialize their results
+DbOperator* parse_pipeline(char* query_command, message* send_message, char* handle, ClientContext* context, AggregateType type) {
+    Column* fetch_column = NULL;
+    Comparator* comparator = parse_fetch_of_select(query_command, send_message, handle, context, &fetch_column);
+    if(comparator == NULL) {
+        return NULL;
+    }
+
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->context = context;
+    dbo->type = PIPELINE; 
+    dbo->operator_fields.pipeline_operator.comparator = comparator;
+    dbo->operator_fields.pipeline_operator.fetch_col = malloc(sizeof(GeneralizedColumn));
+    dbo->operator_fields.pipeline_operator.fetch_col->column_type = COLUMN;
+    dbo->operator_fields.pipeline_operator.fetch_col->column_pointer.column = fetch_column;
+    dbo->operator_fields.pipeline_operator.type = type;
+    strcpy(dbo->operator_fields.pipeline_operator.handle, handle);
+    return dbo;
+}
+
 DbOperator* parse_sum_avg(char* query_command, message* send_message, char* handle, ClientContext* context, bool sum) {
     parse_open_close_parenthesis(&query_command, &send_message->status); 
     if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
         return NULL;
     }
 
+    if(strncmp(query_command, "fetch(", 6) == 0) {
+        return parse_pipeline(query_command, send_message, handle, context, sum ? SUM : AVG);
+    }
+
     char* col_name = query_command;
     GeneralizedColumn* col = find_vec_by_name(col_name, context, false);
     if(col == NULL) {
@@ -653,6 +768,10 @@ DbOperator* parse_min_max(char* query_command, message* send_message, char* hand
         return NULL;
     }
 
+    if(strncmp(query_command, "fetch(", 6) == 0) {
+        return parse_pipeline(query_command, send_message, handle, context, min ? MIN : MAX);
+    }
+
     char* col1_name = strsep(&query_command, ",");
     char* col2_name = query_command;
 
@@ -700,6 +819,84 @@ DbOperator* parse_min_max(char* query_command, message* send_message, char* hand
     return dbo;
 }
 
+// count(vec) counts the values of a vector, count(select(...)) the values a select qualifies
+// without producing their positions
+DbOperator* parse_count(char* query_command, message* send_message, char* handle, ClientContext* context) {
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+
+    DbOperator* dbo = NULL;
+    if(strncmp(query_command, "select(", 7) == 0) {
+        Comparator* comparator = parse_comparator(query_command + 6, send_message, handle, context);
+        if(comparator == NULL) {
+            return NULL;
+        }
+        dbo = malloc(sizeof(DbOperator));
+        dbo->context = context;
+        dbo->type = PIPELINE; 
+        dbo->operator_fields.pipeline_operator.comparator = comparator;
+        dbo->operator_fields.pipeline_operator.fetch_col = NULL;
+        dbo->operator_fields.pipeline_operator.type = COUNT;
+        strcpy(dbo->operator_fields.pipeline_operator.handle, handle);
+        return dbo;
+    }
+
+    GeneralizedColumn* col = find_vec_by_name(query_command, context, false);
+    if(col == NULL) {
+        send_message->status = OBJECT_NOT_FOUND;
+        return NULL;
+    }
+    dbo = malloc(sizeof(DbOperator));
+    dbo->context = context;
+    dbo->type = AGGREGATE; 
+    dbo->operator_fields.aggregate_operator.type = COUNT;
+    strcpy(dbo->operator_fields.aggregate_operator.handle, handle);
+    dbo->operator_fields.aggregate_operator.col1 = col;
+    dbo->operator_fields.aggregate_operator.col2 = NULL;
+    return dbo;
+}
+
+// count_distinct(vec) counts the distinct values exactly, count_distinct(vec,approx) estimates them 
+// from a sketch of the vector
+DbOperator* parse_count_distinct(char* query_command, message* send_message, char* handle, ClientContext* context) {
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+    int num_arguments = count_num_arguments(query_command);
+    if((num_arguments != 1 && num_arguments != 2) || handle == NULL) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    char** command_index = &query_command;
+    char* vec_name = next_token(command_index, &send_message->status);
+    if(num_arguments == 2 && strcmp(next_token(command_index, &send_message->status), "approx") != 0) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    GeneralizedColumn* col = find_vec_by_name(vec_name, context, false);
+    if(col == NULL) {
+        send_message->status = OBJECT_NOT_FOUND;
+        return NULL;
+    }
+    if(col->column_type == RESULT && col->column_pointer.result->data_type != INT) {
+        free(col);
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->context = context;
+    dbo->type = AGGREGATE; 
+    dbo->operator_fields.aggregate_operator.type = num_arguments == 2 ? APPROX_COUNT_DISTINCT : COUNT_DISTINCT;
+    strcpy(dbo->operator_fields.aggregate_operator.handle, handle);
+    dbo->operator_fields.aggregate_operator.col1 = col;
+    dbo->operator_fields.aggregate_operator.col2 = NULL;
+    return dbo;
+}
+
 DbOperator* parse_batch_queries(char* query_command, message* send_message, ClientContext* context) {
     parse_open_close_parenthesis(&query_command, &send_message->status); 
     if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
@@ -715,31 +912,263 @@ DbOperator* parse_batch_queries(char* query_command, message* send_message, Clie
     return dbo;
 }
 
-DbOperator* parse_join(char* query_command, message* send_message, char* handle, ClientContext* context) {
+// parses k,v=group_by(keys,values,agg) where agg is sum, avg, min, max or count, an optional
+// last argument forces the hash or the sort strategy
+DbOperator* parse_group_by(char* query_command, message* send_message, char* handle, ClientContext* context) {
     parse_open_close_parenthesis(&query_command, &send_message->status); 
     if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
         return NULL;
     }
+    int num_arguments = count_num_arguments(query_command);
+    if((num_arguments != 3 && num_arguments != 4) || handle == NULL || count_num_arguments(handle) != 2) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    char** command_index = &query_command;
+    char* keys_name = next_token(command_index, &send_message->status);
+    char* values_name = next_token(command_index, &send_message->status);
+    char* aggregate_name = next_token(command_index, &send_message->status);
+    char* strategy_name = num_arguments == 4 ? next_token(command_index, &send_message->status) : NULL;
+
+    AggregateType type;
+    if(strcmp(aggregate_name, "sum") == 0) {
+        type = SUM;
+    }
+    else if(strcmp(aggregate_name, "avg") == 0) {
+        type = AVG;
+    }
+    else if(strcmp(aggregate_name, "min") == 0) {
+        type = MIN;
+    }
+    else if(strcmp(aggregate_name, "max") == 0) {
+        type = MAX;
+    }
+    else if(strcmp(aggregate_name, "count") == 0) {
+        type = COUNT;
+    }
+    else {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    GroupByStrategy strategy = GROUP_BY_AUTO;
+    if(strategy_name != NULL && strcmp(strategy_name, "hash") == 0) {
+        strategy = GROUP_BY_HASH;
+    }
+    else if(strategy_name != NULL && strcmp(strategy_name, "sort") == 0) {
+        strategy = GROUP_BY_SORT;
+    }
+    else if(strategy_name != NULL) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    GeneralizedColumn* keys = find_vec_by_name(keys_name, context, false);
+    if(keys == NULL) {
+        send_message->status = OBJECT_NOT_FOUND;
+        return NULL;
+    }
+    GeneralizedColumn* values = find_vec_by_name(values_name, context, false);
+    if(values == NULL) {
+        free(keys);
+        send_message->status = OBJECT_NOT_FOUND;
+        return NULL;
+    }
+    // both vectors have to be ints of the same length
+    size_t keys_length = 0;
+    size_t values_length = 0;
+    bool is_long = false;
+    get_aggregate_input(keys, &keys_length, &is_long);
+    get_aggregate_input(values, &values_length, &is_long);
+    if(keys_length != values_length || !is_int_vector(keys) || !is_int_vector(values)) {
+        free(keys);
+        free(values);
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
 
-    char* values1 = strsep(&query_command, ",");
-    char* positions1 = strsep(&query_command, ","); 
-    char* values2 = strsep(&query_command, ",");
-    char* positions2 = strsep(&query_command, ",");
-    char* type = query_command;  
-    
     DbOperator* dbo = malloc(sizeof(DbOperator));
     dbo->context = context;
-    dbo->type = JOIN; 
-    if(strcmp(type, "hash") == 0) {
-        dbo->operator_fields.join_operator.type = HASH;
+    dbo->type = GROUP_BY; 
+    GroupByOperator* group_by = &dbo->operator_fields.group_by_operator;
+    group_by->keys = keys;
+    group_by->values = values;
+    group_by->type = type;
+    group_by->strategy = strategy;
+    strcpy(group_by->handle1, strsep(&handle, ","));
+    strcpy(group_by->handle2, handle);
+    return dbo;
+}
+
+// parses sort(vals) / sort(posn,vals) and, with top_k, topk(vals,k) / topk(posn,vals,k)
+DbOperator* parse_sort(char* query_command, message* send_message, char* handle, ClientContext* context, bool top_k) {
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+    int num_vectors = count_num_arguments(query_command) - (top_k ? 1 : 0);
+    if((num_vectors != 1 && num_vectors != 2) || handle == NULL) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    char** command_index = &query_command;
+    char* positions_name = num_vectors == 2 ? next_token(command_index, &send_message->status) : NULL;
+    char* values_name = next_token(command_index, &send_message->status);
+    long k = 0;
+    if(top_k) {
+        char* k_value = next_token(command_index, &send_message->status);
+        char* end = NULL;
+        k = strtol(k_value, &end, 10);
+        if(*end != '\0' || k < 0) {
+            send_message->status = INCORRECT_FORMAT;
+            return NULL;
+        }
+    }
+
+    GeneralizedColumn* positions = NULL;
+    if(positions_name != NULL) {
+        positions = find_vec_by_name(positions_name, context, true);
+        if(positions == NULL) {
+            send_message->status = OBJECT_NOT_FOUND;
+            return NULL;
+        }
+    }
+    GeneralizedColumn* values = find_vec_by_name(values_name, context, false);
+    if(values == NULL) {
+        free(positions);
+        send_message->status = OBJECT_NOT_FOUND;
+        return NULL;
+    }
+    // the values have to be ints, and the positions one per value
+    size_t values_length = 0;
+    bool values_long = false;
+    get_aggregate_input(values, &values_length, &values_long);
+    if((values->column_type == RESULT && values->column_pointer.result->data_type != INT) ||
+       (positions != NULL && (positions->column_pointer.result->data_type != INT || 
+                              positions->column_pointer.result->num_tuples != values_length))) {
+        free(positions);
+        free(values);
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->context = context;
+    dbo->type = top_k ? TOPK : SORT; 
+    SortOperator* sort_operator = &dbo->operator_fields.sort_operator;
+    sort_operator->positions = positions;
+    sort_operator->values = values;
+    sort_operator->k = (size_t)k;
+    strcpy(sort_operator->handle, handle);
+    return dbo;
+}
+
+// parses one side of a join, either vals,pos or fetch(col,select(...)), and moves past it
+bool parse_join_side(char** query_command, message* send_message, char* handle, ClientContext* context,
+                     Result** values, Result** positions, Comparator** select, Column** fetch_column) {
+    *values = NULL;
+    *positions = NULL;
+    *select = NULL;
+    *fetch_column = NULL;
+    char* side = *query_command;
+    if(side == NULL) {
+        send_message->status = INCORRECT_FORMAT;
+        return false;
+    }
+    if(strncmp(side, "fetch(", 6) != 0) {
+        char* values_name = strsep(query_command, ",");
+        char* positions_name = strsep(query_command, ",");
+        if(positions_name == NULL) {
+            send_message->status = INCORRECT_FORMAT;
+            return false;
+        }
+        *values = lookup_vec(context, values_name);
+        *positions = lookup_vec(context, positions_name);
+        if(*values == NULL || *positions == NULL) {
+            send_message->status = OBJECT_NOT_FOUND;
+            return false;
+        }
+        if((*values)->data_type != INT || (*positions)->data_type != INT) {
+            send_message->status = INCORRECT_FORMAT;
+            return false;
+        }
+        return true;
+    }
+
+    // the side ends at the parenthesis closing the fetch
+    int depth = 1;
+    char* end = side + 6;
+    while(depth > 0 && *end != '\0') {
+        depth += *end == '(' ? 1 : (*end == ')' ? -1 : 0);
+        end++;
+    }
+    if(depth > 0 || (*end != ',' && *end != '\0')) {
+        send_message->status = INCORRECT_FORMAT;
+        return false;
+    }
+    *query_command = *end == ',' ? end + 1 : NULL;
+    *end = '\0';
+    *select = parse_fetch_of_select(side, send_message, handle, context, fetch_column);
+    return *select != NULL;
+}
+
+DbOperator* parse_join(char* query_command, message* send_message, char* handle, ClientContext* context) {
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+    // two sides of values and positions at least, the sides can be fetches with arguments of their own
+    if(handle == NULL || count_num_arguments(handle) != 2 || count_num_arguments(query_command) < 4 ||
+       strcspn(handle, ",") >= HANDLE_MAX_SIZE || strlen(strchr(handle, ',') + 1) >= HANDLE_MAX_SIZE) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    JoinOperator join;
+    if(!parse_join_side(&query_command, send_message, handle, context, &join.val_vec1, &join.pos_vec1, &join.select1, &join.fetch_col1)) {
+        return NULL;
+    }
+    if(!parse_join_side(&query_command, send_message, handle, context, &join.val_vec2, &join.pos_vec2, &join.select2, &join.fetch_col2) ||
+       (join.select1 != NULL && join.select2 != NULL)) {
+        // only one side can be scanned, the other one builds its filter
+        free_join_selects(&join);
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    char* type = strsep(&query_command, ",");  
+    char* order = query_command;
+    
+    if(type == NULL || strcmp(type, "auto") == 0) {
+        join.type = AUTO;
+    }
+    else if(strcmp(type, "hash") == 0) {
+        join.type = HASH;
     }
     else if (strcmp(type, "nested-loop") == 0) {
-        dbo->operator_fields.join_operator.type = NESTED;
+        join.type = NESTED;
+    }
+    else if (strcmp(type, "sort-merge") == 0) {
+        join.type = SORT_MERGE;
+    }
+    else if (strcmp(type, "grace") == 0) {
+        join.type = GRACE;
     }
-    dbo->operator_fields.join_operator.val_vec1 = lookup_vec(context, values1);
-    dbo->operator_fields.join_operator.pos_vec1 = lookup_vec(context, positions1);
-    dbo->operator_fields.join_operator.val_vec2 = lookup_vec(context, values2);
-    dbo->operator_fields.join_operator.pos_vec2 = lookup_vec(context, positions2);
+    else if (strcmp(type, "index") == 0) {
+        join.type = INDEX;
+    }
+    else {
+        free_join_selects(&join);
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+    join.sorted = order != NULL && strcmp(order, "sorted") == 0;
+    
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->context = context;
+    dbo->type = JOIN; 
+    dbo->operator_fields.join_operator = join;
     char* handle1 = strsep(&handle, ",");
     char* handle2 = handle;
     strcpy(dbo->operator_fields.join_operator.handle1, handle1); 
@@ -748,6 +1177,60 @@ DbOperator* parse_join(char* query_command, message* send_message, char* handle,
 }
 
 
+DbOperator* parse_multi_join(char* query_command, message* send_message, char* handle, ClientContext* context) {
+    parse_open_close_parenthesis(&query_command, &send_message->status); 
+    if(send_message->status == INCORRECT_FORMAT || send_message->status == UNKNOWN_COMMAND) {
+        return NULL;
+    }
+    // the fact positions, then a fact key, dimension values and dimension positions per dimension
+    int num_arguments = count_num_arguments(query_command);
+    size_t num_dimensions = (num_arguments - 1) / 3;
+    if(handle == NULL || num_arguments < 4 || (num_arguments - 1) % 3 != 0 || num_dimensions > MULTI_JOIN_MAX_DIMENSIONS ||
+       (size_t)count_commas(handle) != num_dimensions) {
+        send_message->status = INCORRECT_FORMAT;
+        return NULL;
+    }
+
+    MultiJoinOperator multi_join;
+    multi_join.num_dimensions = num_dimensions;
+    multi_join.fact_positions = lookup_vec(context, strsep(&query_command, ","));
+    bool found = multi_join.fact_positions != NULL;
+    for(size_t i = 0; i < num_dimensions; i++) {
+        multi_join.fact_keys[i] = lookup_vec(context, strsep(&query_command, ","));
+        multi_join.dimension_values[i] = lookup_vec(context, strsep(&query_command, ","));
+        multi_join.dimension_positions[i] = lookup_vec(context, strsep(&query_command, ","));
+        found = found && multi_join.fact_keys[i] != NULL && multi_join.dimension_values[i] != NULL &&
+                multi_join.dimension_positions[i] != NULL;
+    }
+    if(!found) {
+        send_message->status = OBJECT_NOT_FOUND;
+        return NULL;
+    }
+    for(size_t i = 0; i < num_dimensions; i++) {
+        if(multi_join.fact_keys[i]->num_tuples != multi_join.fact_positions->num_tuples ||
+           multi_join.dimension_values[i]->num_tuples != multi_join.dimension_positions[i]->num_tuples ||
+           multi_join.fact_positions->data_type != INT || multi_join.fact_keys[i]->data_type != INT ||
+           multi_join.dimension_values[i]->data_type != INT || multi_join.dimension_positions[i]->data_type != INT) {
+            send_message->status = INCORRECT_FORMAT;
+            return NULL;
+        }
+    }
+    for(size_t i = 0; i <= num_dimensions; i++) {
+        char* output = strsep(&handle, ",");
+        if(strlen(output) >= HANDLE_MAX_SIZE) {
+            send_message->status = INCORRECT_FORMAT;
+            return NULL;
+        }
+        strcpy(multi_join.handles[i], output);
+    }
+
+    DbOperator* dbo = malloc(sizeof(DbOperator));
+    dbo->context = context;
+    dbo->type = MULTI_JOIN; 
+    dbo->operator_fields.multi_join_operator = multi_join;
+    return dbo;
+}
+
 DbOperator* parse_command(char* query_command, message* send_message, ClientContext* context, DbOperator* operator) {
     DbOperator* dbo = NULL;
     if (strncmp(query_command, "--", 2) == 0) {
@@ -798,6 +1281,21 @@ DbOperator* parse_command(char* query_command, message* send_message, ClientCont
     } else if (strncmp(query_command, "avg", 3) == 0) {
         query_command += 3;    
         dbo = parse_sum_avg(query_command, send_message, handle, context, false); 
+    } else if (strncmp(query_command, "group_by", 8) == 0) {
+        query_command += 8;    
+        dbo = parse_group_by(query_command, send_message, handle, context); 
+    } else if (strncmp(query_command, "count_distinct", 14) == 0) {
+        query_command += 14;    
+        dbo = parse_count_distinct(query_command, send_message, handle, context); 
+    } else if (strncmp(query_command, "count", 5) == 0) {
+        query_command += 5;    
+        dbo = parse_count(query_command, send_message, handle, context); 
+    } else if (strncmp(query_command, "sort", 4) == 0) {
+        query_command += 4;    
+        dbo = parse_sort(query_command, send_message, handle, context, false); 
+    } else if (strncmp(query_command, "topk", 4) == 0) {
+        query_command += 4;    
+        dbo = parse_sort(query_command, send_message, handle, context, true); 
     } else if (strncmp(query_command, "sub", 3) == 0) {
         query_command += 3;    
         dbo = parse_sub_add(query_command, send_message, handle, context, true); 
@@ -820,6 +1318,9 @@ DbOperator* parse_command(char* query_command, message* send_message, ClientCont
     } else if (strncmp(query_command, "join", 4) == 0) {
         query_command += 4; 
         dbo = parse_join(query_command, send_message, handle, context); 
+    } else if (strncmp(query_command, "multi_join", 10) == 0) {
+        query_command += 10; 
+        dbo = parse_multi_join(query_command, send_message, handle, context); 
     }
     return dbo;
 }
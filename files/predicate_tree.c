@@ -0,0 +1,195 @@
+#include <limits.h>
+#include <string.h>
+
+#include "include/predicate_tree.h"
+
+typedef struct PredicateRange {
+    long low;
+    long high;
+    size_t comparator;
+} PredicateRange;
+
+int compare_predicate_ranges(const void* a, const void* b) {
+    const PredicateRange* range1 = (const PredicateRange*) a;
+    const PredicateRange* range2 = (const PredicateRange*) b;
+    if(range1->low != range2->low) {
+        return range1->low < range2->low ? -1 : 1;
+    }
+    if(range1->high != range2->high) {
+        return range1->high < range2->high ? -1 : 1;
+    }
+    return 0;
+}
+
+int compare_longs(const void* a, const void* b) {
+    long val1 = *(const long*) a;
+    long val2 = *(const long*) b;
+    return val1 < val2 ? -1 : (val1 > val2 ? 1 : 0);
+}
+
+// returns the position of val in the sorted bounds (val must be one of them)
+size_t find_bound(long* bounds, size_t num_bounds, long val) {
+    size_t low = 0;
+    size_t high = num_bounds;
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+        if(bounds[mid] < val) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// returns the leaf of val, the number of bounds smaller or equal to val
+size_t find_leaf(long* bounds, size_t num_bounds, long val) {
+    size_t low = 0;
+    size_t high = num_bounds;
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+        if(bounds[mid] <= val) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// the number of tree levels a row walks through for num_comparators predicates
+size_t predicate_tree_depth(size_t num_comparators) {
+    size_t depth = 1;
+    for(size_t leaves = 1; leaves < 2 * num_comparators + 1; leaves *= 2) {
+        depth++;
+    }
+    return depth;
+}
+
+PredicateTree* predicate_tree_create(Comparator** comparators, size_t num_comparators) {
+    PredicateTree* tree = malloc(sizeof(PredicateTree));
+    tree->comparator_predicates = malloc(sizeof(size_t) * num_comparators);
+
+    // sort the ranges so identical comparators end up next to each other and share a predicate
+    PredicateRange* ranges = malloc(sizeof(PredicateRange) * num_comparators);
+    for(size_t i = 0; i < num_comparators; i++) {
+        ranges[i].low = comparators[i]->type1 == NO_COMPARISON ? LONG_MIN : comparators[i]->p_low;
+        ranges[i].high = comparators[i]->type2 == NO_COMPARISON ? LONG_MAX : comparators[i]->p_high;
+        ranges[i].comparator = i;
+    }
+    qsort(ranges, num_comparators, sizeof(PredicateRange), compare_predicate_ranges);
+
+    size_t num_predicates = 0;
+    for(size_t i = 0; i < num_comparators; i++) {
+        if(i == 0 || compare_predicate_ranges(&ranges[i - 1], &ranges[i]) != 0) {
+            ranges[num_predicates++] = ranges[i];
+        }
+        tree->comparator_predicates[ranges[i].comparator] = num_predicates - 1;
+    }
+    tree->num_predicates = num_predicates;
+
+    // collect the distinct finite bounds
+    tree->bounds = malloc(sizeof(long) * 2 * num_predicates);
+    size_t num_bounds = 0;
+    for(size_t i = 0; i < num_predicates; i++) {
+        if(ranges[i].low != LONG_MIN) {
+            tree->bounds[num_bounds++] = ranges[i].low;
+        }
+        if(ranges[i].high != LONG_MAX) {
+            tree->bounds[num_bounds++] = ranges[i].high;
+        }
+    }
+    qsort(tree->bounds, num_bounds, sizeof(long), compare_longs);
+    size_t num_distinct = 0;
+    for(size_t i = 0; i < num_bounds; i++) {
+        if(i == 0 || tree->bounds[i] != tree->bounds[num_distinct - 1]) {
+            tree->bounds[num_distinct++] = tree->bounds[i];
+        }
+    }
+    tree->num_bounds = num_distinct;
+
+    tree->tree_size = 1;
+    while(tree->tree_size < tree->num_bounds + 1) {
+        tree->tree_size *= 2;
+    }
+
+    // every predicate covers the leaves [first_leaf, last_leaf), we store it in the canonical 
+    // nodes of that range. The first pass counts the predicates per node, the second places them. 
+    size_t num_nodes = 2 * tree->tree_size;
+    tree->node_offsets = calloc(num_nodes + 1, sizeof(size_t));
+    size_t* node_fill = calloc(num_nodes, sizeof(size_t));
+    tree->node_predicates = NULL;
+    for(int pass = 0; pass < 2; pass++) {
+        for(size_t i = 0; i < num_predicates; i++) {
+            size_t first_leaf = 0;
+            size_t last_leaf = tree->num_bounds + 1;
+            if(ranges[i].low != LONG_MIN) {
+                first_leaf = find_bound(tree->bounds, tree->num_bounds, ranges[i].low) + 1;
+            }
+            if(ranges[i].high != LONG_MAX) {
+                last_leaf = find_bound(tree->bounds, tree->num_bounds, ranges[i].high) + 1;
+            }
+            size_t left = first_leaf + tree->tree_size;
+            size_t right = last_leaf + tree->tree_size;
+            while(left < right) {
+                if(left & 1) {
+                    if(pass == 0) {
+                        tree->node_offsets[left + 1]++;
+                    }
+                    else {
+                        tree->node_predicates[tree->node_offsets[left] + node_fill[left]++] = i;
+                    }
+                    left++;
+                }
+                if(right & 1) {
+                    right--;
+                    if(pass == 0) {
+                        tree->node_offsets[right + 1]++;
+                    }
+                    else {
+                        tree->node_predicates[tree->node_offsets[right] + node_fill[right]++] = i;
+                    }
+                }
+                left /= 2;
+                right /= 2;
+            }
+        }
+        if(pass == 0) {
+            for(size_t node = 0; node < num_nodes; node++) {
+                tree->node_offsets[node + 1] += tree->node_offsets[node];
+            }
+            tree->node_predicates = malloc(sizeof(size_t) * (tree->node_offsets[num_nodes] + 1));
+        }
+    }
+
+    free(node_fill);
+    free(ranges);
+    return tree;
+}
+
+void free_predicate_tree(PredicateTree* tree) {
+    free(tree->bounds);
+    free(tree->node_offsets);
+    free(tree->node_predicates);
+    free(tree->comparator_predicates);
+    free(tree);
+}
+
+void predicate_tree_select(PredicateTree* tree, int* data, int* pos_vec, Result** results, size_t cur_loc, size_t vector_size, size_t data_length) {
+    size_t end = cur_loc + vector_size < data_length ? cur_loc + vector_size : data_length;
+    size_t* offsets = tree->node_offsets;
+    size_t* predicates = tree->node_predicates;
+    for(size_t i = cur_loc; i < end; i++) {
+        int pos = pos_vec == NULL ? (int)i : pos_vec[i];
+        size_t node = find_leaf(tree->bounds, tree->num_bounds, data[i]) + tree->tree_size;
+        while(node > 0) {
+            for(size_t j = offsets[node]; j < offsets[node + 1]; j++) {
+                Result* result = results[predicates[j]];
+                ((int*)result->payload)[result->num_tuples++] = pos;
+            }
+            node /= 2;
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include "include/radix_sort.h"
+#include "include/parallel.h"
+
+int radix_bits_needed(uint64_t max_value) {
+    int bits = 0;
+    while(bits < 64 && (max_value >> bits) != 0) {
+        bits++;
+    }
+    return bits;
+}
+
+uint64_t* radix_sort(uint64_t* keys, uint64_t* buffer, size_t num_keys, int low_bit, int high_bit) {
+    size_t counts[1 << RADIX_BITS];
+
+    for(int shift = low_bit; shift < high_bit; shift += RADIX_BITS) {
+        // the last pass only looks at the bits left below high_bit
+        int digit_bits = high_bit - shift < RADIX_BITS ? high_bit - shift : RADIX_BITS;
+        uint64_t digit_mask = ((uint64_t)1 << digit_bits) - 1;
+        memset(counts, 0, sizeof(counts));
+        for(size_t i = 0; i < num_keys; i++) {
+            counts[(keys[i] >> shift) & digit_mask]++;
+        }
+        // a digit all the keys share leaves the order as it is
+        if(num_keys == 0 || counts[(keys[0] >> shift) & digit_mask] == num_keys) {
+            continue;
+        }
+        size_t offset = 0;
+        for(size_t digit = 0; digit <= digit_mask; digit++) {
+            size_t count = counts[digit];
+            counts[digit] = offset;
+            offset += count;
+        }
+        for(size_t i = 0; i < num_keys; i++) {
+            buffer[counts[(keys[i] >> shift) & digit_mask]++] = keys[i];
+        }
+        uint64_t* sorted = buffer;
+        buffer = keys;
+        keys = sorted;
+    }
+    return keys;
+}
+
+typedef struct RadixChunk {
+    uint64_t* keys;
+    uint64_t* out;
+    size_t num_keys;
+    int shift;
+    // the histogram of the chunk, then the positions its keys of every digit go to
+    size_t counts[1 << RADIX_BITS];
+} RadixChunk;
+
+void* count_radix_chunk(void* args) {
+    RadixChunk* chunk = (RadixChunk*) args;
+    memset(chunk->counts, 0, sizeof(chunk->counts));
+    for(size_t i = 0; i < chunk->num_keys; i++) {
+        chunk->counts[(chunk->keys[i] >> chunk->shift) & ((1 << RADIX_BITS) - 1)]++;
+    }
+    return args;
+}
+
+void* scatter_radix_chunk(void* args) {
+    RadixChunk* chunk = (RadixChunk*) args;
+    for(size_t i = 0; i < chunk->num_keys; i++) {
+        uint64_t key = chunk->keys[i];
+        chunk->out[chunk->counts[(key >> chunk->shift) & ((1 << RADIX_BITS) - 1)]++] = key;
+    }
+    return args;
+}
+
+typedef struct RadixBucket {
+    uint64_t* keys;
+    uint64_t* buffer;
+    size_t num_keys;
+    int low_bit;
+    int high_bit;
+} RadixBucket;
+
+// sorts a bucket and leaves it in keys, whichever array the passes ended in
+void* sort_radix_bucket(void* args) {
+    RadixBucket* bucket = (RadixBucket*) args;
+    uint64_t* sorted = radix_sort(bucket->keys, bucket->buffer, bucket->num_keys, bucket->low_bit, bucket->high_bit);
+    if(sorted != bucket->keys) {
+        memcpy(bucket->keys, sorted, sizeof(uint64_t) * bucket->num_keys);
+    }
+    return args;
+}
+
+uint64_t* parallel_radix_sort(uint64_t* keys, uint64_t* buffer, size_t num_keys, int low_bit, int high_bit) {
+    size_t num_threads = get_num_cores();
+    if(num_keys < PARALLEL_SORT_THRESHOLD || num_threads < 2 || high_bit - low_bit <= RADIX_BITS) {
+        return radix_sort(keys, buffer, num_keys, low_bit, high_bit);
+    }
+
+    // the top digit goes first, its buckets hold disjoint key ranges in order
+    int shift = high_bit - RADIX_BITS;
+    size_t num_chunks = num_threads;
+    size_t chunk_size = (num_keys + num_chunks - 1) / num_chunks;
+    RadixChunk* chunks = malloc(sizeof(RadixChunk) * num_chunks);
+    for(size_t i = 0; i < num_chunks; i++) {
+        size_t first = i * chunk_size < num_keys ? i * chunk_size : num_keys;
+        chunks[i].keys = keys + first;
+        chunks[i].out = buffer;
+        chunks[i].num_keys = num_keys - first < chunk_size ? num_keys - first : chunk_size;
+        chunks[i].shift = shift;
+    }
+    run_tasks_in_parallel(count_radix_chunk, chunks, sizeof(RadixChunk), num_chunks, num_threads);
+
+    // a digit's keys from earlier chunks go before the ones from later chunks, which keeps the sort stable
+    size_t bucket_starts[(1 << RADIX_BITS) + 1];
+    size_t offset = 0;
+    for(size_t digit = 0; digit < (1 << RADIX_BITS); digit++) {
+        bucket_starts[digit] = offset;
+        for(size_t i = 0; i < num_chunks; i++) {
+            size_t count = chunks[i].counts[digit];
+            chunks[i].counts[digit] = offset;
+            offset += count;
+        }
+    }
+    bucket_starts[1 << RADIX_BITS] = offset;
+    run_tasks_in_parallel(scatter_radix_chunk, chunks, sizeof(RadixChunk), num_chunks, num_threads);
+    free(chunks);
+
+    RadixBucket* buckets = malloc(sizeof(RadixBucket) * (1 << RADIX_BITS));
+    size_t num_buckets = 0;
+    for(size_t digit = 0; digit < (1 << RADIX_BITS); digit++) {
+        size_t bucket_length = bucket_starts[digit + 1] - bucket_starts[digit];
+        if(bucket_length > 1) {
+            buckets[num_buckets].keys = buffer + bucket_starts[digit];
+            buckets[num_buckets].buffer = keys + bucket_starts[digit];
+            buckets[num_buckets].num_keys = bucket_length;
+            buckets[num_buckets].low_bit = low_bit;
+            buckets[num_buckets].high_bit = shift;
+            num_buckets++;
+        }
+    }
+    run_tasks_in_parallel(sort_radix_bucket, buckets, sizeof(RadixBucket), num_buckets, num_threads);
+    free(buckets);
+    return buffer;
+}
@@ -27,6 +27,7 @@
 #include "include/message.h"
 #include "include/utils.h"
 #include "include/client_context.h"
+#include "include/deferred.h"
 
 #define DEFAULT_QUERY_BUFFER_SIZE 1024
 
@@ -77,17 +78,38 @@ size_t get_generalized_column_length(GeneralizedColumn* column) {
     }
 }
 
+// The client was told a deferred query succeeded when it was sent. If one failed once it ran, the
+// next successful reply carries its error in place of OK.
+void report_deferred_status(ClientContext* context, message* send_message) {
+    if(context->deferred_status != OK_DONE &&
+       (send_message->status == OK_DONE || send_message->status == OK_WAIT_FOR_RESPONSE)) {
+        send_message->status = context->deferred_status;
+        context->deferred_status = OK_DONE;
+    }
+}
+
 void execute_print(DbOperator* query, message* send_message, message* recv_message, int client_socket) {
     size_t num_columns = query->operator_fields.print_operator.num_columns;
     GeneralizedColumn** columns = query->operator_fields.print_operator.columns;
     size_t num_tuples = get_generalized_column_length(columns[0]);
     
+    // several rows of ints go as they are, other types are announced first
+    bool typed_rows = false;
+    for(size_t i = 0; i < num_columns; i++) {
+        if(columns[i]->column_type == RESULT && columns[i]->column_pointer.result->data_type != INT) {
+            typed_rows = true;
+        }
+    }
+
     //transmit print meta
     int print_meta[2];
     print_meta[0] = num_columns;
     if(num_tuples == 1) {
         print_meta[1] = 0;
     }
+    else if(typed_rows) {
+        print_meta[1] = 2;
+    }
     else {
         print_meta[1] = 1; 
     }
@@ -163,51 +185,66 @@ void execute_print(DbOperator* query, message* send_message, message* recv_messa
         }
     }
     else {
-        int* data[num_columns];
+        int column_types[num_columns];
+        size_t type_sizes[num_columns];
+        char* data[num_columns];
+        size_t row_size = 0;
         for(size_t i = 0; i < num_columns; i++) {
             GeneralizedColumn* cur_col = columns[i];
             if(cur_col->column_type == COLUMN) {
-                data[i] = cur_col->column_pointer.column->data;
+                column_types[i] = 0;
+                type_sizes[i] = sizeof(int);
+                data[i] = (char*)cur_col->column_pointer.column->data;
             }
             else {
-                data[i] = (int*)cur_col->column_pointer.result->payload; 
+                Result* res_col = cur_col->column_pointer.result;
+                switch(res_col->data_type) {
+                    case INT:
+                        column_types[i] = 0;
+                        type_sizes[i] = sizeof(int);
+                        break;
+                    case LONG:
+                        column_types[i] = 1;
+                        type_sizes[i] = sizeof(long);
+                        break;
+                    case DOUBLE:
+                        column_types[i] = 2;
+                        type_sizes[i] = sizeof(double);
+                        break;
+                }
+                data[i] = (char*)res_col->payload; 
             }
+            row_size += type_sizes[i];
+        }
+
+        if(typed_rows) {
+            send_message->payload = (char*)column_types;
+            send_message->length = sizeof(int) * num_columns;  
+            send_message_to_socket(client_socket, send_message);
+            receive_message_from_socket(client_socket, recv_message);
+            free(recv_message->payload);
         }
 
-        int num_tuples_per_buffer = 512;
-        int column_buffer_size = num_tuples_per_buffer * sizeof(int);
-        int total_buffer_size = column_buffer_size * num_columns;
-        char buffer[total_buffer_size];
+        // every buffer holds the values of the columns one after the other
+        size_t num_tuples_per_buffer = 512;
+        char buffer[num_tuples_per_buffer * row_size];
         send_message->payload = buffer;
-        send_message->length = total_buffer_size;
-        int tuples_sent = 0;
         
-        for(size_t i = 0; i + num_tuples_per_buffer < num_tuples; i += num_tuples_per_buffer) {
+        for(size_t i = 0; i < num_tuples; i += num_tuples_per_buffer) {
+            size_t tuples_left = num_tuples - i;
+            size_t buffer_tuples = tuples_left < num_tuples_per_buffer ? tuples_left : num_tuples_per_buffer;
+            size_t offset = 0;
             for(size_t j = 0; j < num_columns; j++) {
-                memcpy(buffer + (j * column_buffer_size), &(data[j][i]), column_buffer_size);
+                memcpy(buffer + offset, data[j] + i * type_sizes[j], buffer_tuples * type_sizes[j]);
+                offset += buffer_tuples * type_sizes[j];
             }
-            tuples_sent += num_tuples_per_buffer;
+            send_message->length = offset;
 
             send_message_to_socket(client_socket, send_message);
             receive_message_from_socket(client_socket, recv_message);
             free(recv_message->payload);
         }
 
-        int tuples_left = num_tuples - tuples_sent;
-        num_tuples_per_buffer = tuples_left;
-        column_buffer_size = num_tuples_per_buffer * sizeof(int);
-        total_buffer_size = column_buffer_size * num_columns;
-        char new_buffer[total_buffer_size];
-        send_message->payload = new_buffer;
-        send_message->length = total_buffer_size;
-        for(size_t j = 0; j < num_columns; j++) {
-            memcpy(new_buffer + (j * column_buffer_size), &(data[j][tuples_sent]), column_buffer_size);
-        }
-
-        send_message_to_socket(client_socket, send_message);
-        receive_message_from_socket(client_socket, recv_message);
-        free(recv_message->payload);
-
         // transmit end print
         send_message->payload = "";
         send_message->length = -1; 
@@ -241,6 +278,12 @@ int handle_client(int client_socket) {
     client_context->chandle_slots = DEFAULT_CLIENT_HANDLES;
     client_context->chandles_in_use = 0; 
     client_context->chandle_table = (ResultHandle*) malloc(sizeof(ResultHandle) * client_context->chandle_slots);
+    client_context->cached_results = 0;
+    client_context->cached_bytes = 0;
+    client_context->deferred_slots = DEFAULT_DEFERRED_QUERIES;
+    client_context->deferred_in_use = 0;
+    client_context->deferred_queries = (DeferredQuery*) malloc(sizeof(DeferredQuery) * client_context->deferred_slots);
+    client_context->deferred_status = OK_DONE;
     if (pthread_mutex_init(&client_context->mutex, NULL) != 0) {
         printf("\n mutex init failed\n");
         return 1;
@@ -276,6 +319,8 @@ int handle_client(int client_socket) {
                     free(recv_message.payload);
                     send_message_to_socket(client_socket, &send_message);
                 }
+                // the deferred queries read the tables as they were before the load
+                flush_deferred_queries(client_context, NULL, 0);
                 execute_load(buffer);
                 send_message_to_socket(client_socket, &send_message);
                 free(buffer);
@@ -283,8 +328,27 @@ int handle_client(int client_socket) {
                 continue;
             }
 
+            // queries that only write a handle run once something needs the handle
+            if(defer_query(client_context, recv_message.payload)) {
+                free(recv_message.payload);
+                char* result = ""; 
+                send_message.status = OK_WAIT_FOR_RESPONSE;
+                // a handle written again can make earlier deferred queries run
+                report_deferred_status(client_context, &send_message);
+                send_message.length = strlen(result);
+                send_message.payload = malloc(send_message.length + 1);
+                strcpy(send_message.payload, result);
+                send_message_to_socket(client_socket, &send_message);
+                free(send_message.payload);
+                continue;
+            }
+            char* query_command = flush_deferred_queries_before(client_context, recv_message.payload);
+
             // 1. Parse command
-            DbOperator* query = parse_command(recv_message.payload, &send_message, client_context, NULL);
+            DbOperator* query = parse_command(query_command, &send_message, client_context, NULL);
+            if(query_command != recv_message.payload) {
+                free(query_command);
+            }
             free(recv_message.payload);
             if(query != NULL && query->type == PRINT) {
                 execute_print(query, &send_message, &recv_message, client_socket);
@@ -317,6 +381,8 @@ int handle_client(int client_socket) {
                 } while(batch_query == NULL);
             }
 
+            // a shutdown frees the client context
+            report_deferred_status(client_context, &send_message);
             char* result = execute_db_operator(query);  
             if(result == NULL) {
                 result = ""; 
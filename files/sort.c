@@ -0,0 +1,163 @@
+#include <stdint.h>
+
+#include "include/sort.h"
+#include "include/client_context.h"
+#include "include/parallel.h"
+#include "include/radix_sort.h"
+
+void sort_positions(int* values, size_t num_values, int* out) {
+    uint64_t* keys = malloc(sizeof(uint64_t) * num_values);
+    uint64_t* buffer = malloc(sizeof(uint64_t) * num_values);
+    for(size_t i = 0; i < num_values; i++) {
+        keys[i] = key_with_position(values[i], i);
+    }
+    uint64_t* sorted = parallel_radix_sort(keys, buffer, num_values, 32, 64);
+    for(size_t i = 0; i < num_values; i++) {
+        out[i] = (int)position_of(sorted[i]);
+    }
+    free(keys);
+    free(buffer);
+}
+
+// the rank of a value orders by value and then by earlier position, so one compare of two ranks
+// decides which of the values ranks higher
+static inline uint64_t rank_of(int value, size_t pos) {
+    return key_with_position(value, 0xffffffffu - pos);
+}
+
+static inline size_t position_of_rank(uint64_t rank) {
+    return 0xffffffffu - position_of(rank);
+}
+
+// min-heap of ranks, the root is the lowest ranked value kept so far
+static void sift_down(uint64_t* heap, size_t heap_size, size_t i) {
+    while(2 * i + 1 < heap_size) {
+        size_t child = 2 * i + 1;
+        if(child + 1 < heap_size && heap[child + 1] < heap[child]) {
+            child++;
+        }
+        if(heap[i] <= heap[child]) {
+            break;
+        }
+        uint64_t tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
+        i = child;
+    }
+}
+
+static void sift_up(uint64_t* heap, size_t i) {
+    while(i > 0 && heap[(i - 1) / 2] > heap[i]) {
+        uint64_t tmp = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+}
+
+// keeps the k highest ranks seen, once the heap is full most values lose against the root
+static inline void push_rank(uint64_t* heap, size_t* heap_size, size_t k, uint64_t rank) {
+    if(*heap_size < k) {
+        heap[*heap_size] = rank;
+        sift_up(heap, (*heap_size)++);
+    }
+    else if(rank > heap[0]) {
+        heap[0] = rank;
+        sift_down(heap, k, 0);
+    }
+}
+
+typedef struct TopKChunk {
+    int* values;
+    // position of the first value of the chunk
+    size_t first;
+    size_t num_values;
+    size_t k;
+    uint64_t* heap;
+    size_t heap_size;
+} TopKChunk;
+
+void* top_k_chunk(void* args) {
+    TopKChunk* chunk = (TopKChunk*) args;
+    chunk->heap = malloc(sizeof(uint64_t) * chunk->k);
+    chunk->heap_size = 0;
+    for(size_t i = 0; i < chunk->num_values; i++) {
+        push_rank(chunk->heap, &chunk->heap_size, chunk->k, rank_of(chunk->values[i], chunk->first + i));
+    }
+    return args;
+}
+
+size_t top_k_positions(int* values, size_t num_values, size_t k, int* out) {
+    k = k < num_values ? k : num_values;
+    if(k == 0) {
+        return 0;
+    }
+    size_t num_chunks = (num_values + TOP_K_CHUNK_SIZE - 1) / TOP_K_CHUNK_SIZE;
+    TopKChunk* chunks = malloc(sizeof(TopKChunk) * num_chunks);
+    for(size_t i = 0; i < num_chunks; i++) {
+        chunks[i].first = i * TOP_K_CHUNK_SIZE;
+        chunks[i].values = values + chunks[i].first;
+        chunks[i].num_values = num_values - chunks[i].first < TOP_K_CHUNK_SIZE ? num_values - chunks[i].first : TOP_K_CHUNK_SIZE;
+        chunks[i].k = k;
+    }
+    run_tasks_in_parallel(top_k_chunk, chunks, sizeof(TopKChunk), num_chunks, get_num_cores());
+
+    // the top k of all the values are among the top k of the chunks
+    uint64_t* heap = chunks[0].heap;
+    size_t heap_size = chunks[0].heap_size;
+    for(size_t i = 1; i < num_chunks; i++) {
+        for(size_t j = 0; j < chunks[i].heap_size; j++) {
+            push_rank(heap, &heap_size, k, chunks[i].heap[j]);
+        }
+        free(chunks[i].heap);
+    }
+    free(chunks);
+
+    // popping the root gives the ranks from the lowest up, so out is filled from the back
+    for(size_t i = heap_size; i > 0; i--) {
+        out[i - 1] = (int)position_of_rank(heap[0]);
+        heap[0] = heap[i - 1];
+        sift_down(heap, i - 1, 0);
+    }
+    free(heap);
+    return k;
+}
+
+// maps positions into the values to the positions of the position vector, if the operator has one
+static void map_positions(SortOperator* sort_operator, int* out, size_t num_positions) {
+    if(sort_operator->positions == NULL) {
+        return;
+    }
+    int* positions = (int*)sort_operator->positions->column_pointer.result->payload;
+    for(size_t i = 0; i < num_positions; i++) {
+        out[i] = positions[out[i]];
+    }
+}
+
+void execute_sort(DbOperator* query) {
+    SortOperator* sort_operator = &query->operator_fields.sort_operator;
+    size_t num_values = 0;
+    bool is_long = false;
+    int* values = get_aggregate_input(sort_operator->values, &num_values, &is_long);
+
+    Result* result = init_result();
+    result->num_tuples = num_values;
+    result->payload = malloc(sizeof(int) * (num_values > 0 ? num_values : 1));
+    sort_positions(values, num_values, result->payload);
+    map_positions(sort_operator, result->payload, num_values);
+    add_result_to_context(query->context, sort_operator->handle, result);
+}
+
+void execute_topk(DbOperator* query) {
+    SortOperator* sort_operator = &query->operator_fields.sort_operator;
+    size_t num_values = 0;
+    bool is_long = false;
+    int* values = get_aggregate_input(sort_operator->values, &num_values, &is_long);
+
+    size_t k = sort_operator->k < num_values ? sort_operator->k : num_values;
+    Result* result = init_result();
+    result->payload = malloc(sizeof(int) * (k > 0 ? k : 1));
+    result->num_tuples = top_k_positions(values, num_values, k, result->payload);
+    map_positions(sort_operator, result->payload, result->num_tuples);
+    add_result_to_context(query->context, sort_operator->handle, result);
+}